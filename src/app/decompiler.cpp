@@ -3,9 +3,13 @@
 #include "segoff.h"
 #include "cmdarg/cmdarg.h"
 #include "array.h"
+#include "db/db.h"
 
 #include "common/common.h"
+#include "common/hash.h"
+#include "common/stats.h"
 #include <cstdint>
+#include <type_traits>
 
 namespace decompiler
 {
@@ -22,9 +26,14 @@ namespace decompiler
     fprintf(stderr, "\n");
     fprintf(stderr, "OPTIONS:\n");
     fprintf(stderr, "  --config       path to configuration file (.bsl) (optional)\n");
-    fprintf(stderr, "  --binary       path to binary on the filesystem (required)\n");
+    fprintf(stderr, "  --binary       path to raw binary on the filesystem (this or --exe required)\n");
+    fprintf(stderr, "  --exe          path to MZ executable, addresses relative to its load image\n");
     fprintf(stderr, "  --start-addr   start seg:off address (required)\n");
     fprintf(stderr, "  --end-addr     end seg:off address (required)\n");
+    fprintf(stderr, "  --db           project database directory, reuses unchanged results (optional)\n");
+    fprintf(stderr, "  --sigs         library signature file (.bsl), adds recognised functions to the config (optional)\n");
+    fprintf(stderr, "  --stats        print analysis counters, phase timings and the slowest functions to stderr (optional)\n");
+    fprintf(stderr, "  --stats-json   as --stats, formatted as JSON (optional)\n");
   }
 
   static bool cmdarg_segoff(int * argc, char *** argv, const char * name, segoff_t *_out)
@@ -40,8 +49,13 @@ namespace decompiler
   {
     const char * config;
     const char * binary;
+    const char * exe;
     segoff_t     start;
     segoff_t     end;
+    const char * db;
+    const char * sigs;
+    bool         stats;
+    bool         stats_json;
   };
 
   static int run(options_t *opt);
@@ -56,7 +70,20 @@ namespace decompiler
     found = cmdarg_string(&argc, &argv, "--config", &opt->config);
     (void)found; /* optional */
 
+    found = cmdarg_string(&argc, &argv, "--db", &opt->db);
+    (void)found; /* optional */
+
+    found = cmdarg_string(&argc, &argv, "--sigs", &opt->sigs);
+    (void)found; /* optional */
+
+    found = cmdarg_option(&argc, &argv, "--stats", &opt->stats);
+    (void)found; /* optional */
+
+    found = cmdarg_option(&argc, &argv, "--stats-json", &opt->stats_json);
+    (void)found; /* optional */
+
     found = cmdarg_string(&argc, &argv, "--binary", &opt->binary);
+    found = cmdarg_string(&argc, &argv, "--exe", &opt->exe) || found;
     if (!found) { print_help(stderr, argv[0]); return 3; }
 
     found = cmdarg_segoff(&argc, &argv, "--start-addr", &opt->start);
@@ -84,25 +111,78 @@ namespace decompiler
     size_t end_idx = segoff_abs(opt->end);
 
 
-    dynarray mem = read_file(opt->binary);
+    dynarray mem;
+    dos::executable_t exe;
+    segment<uint8_t> region;
+    const dos::relocation_index_t *relocs = nullptr;
+    if (opt->exe) {
+      if (!exe.open(opt->exe)) FAIL("Failed to load MZ executable: '%s'", opt->exe);
+      if (end_idx > exe.image.size()) FAIL("End address is beyond the load image");
+      region = exe.image.slice(start_idx, end_idx - start_idx);
+      relocs = &exe.relocs;
+    } else {
+      mem = read_file(opt->binary);
+      region = mem.segment(start_idx, end_idx - start_idx);
+    }
+    size_t storage = opt->exe ? exe.image.size() : mem.size();
+
+    if (opt->sigs) {
+      if (!cfg) cfg = dis86_decompile_config_default_new();
+      segment<uint8_t> image = opt->exe ? exe.image : mem.segment(0, mem.size());
+      size_t n = dis86_decompile_config_apply_signatures(cfg, opt->sigs, image, 0, opt->start.seg);
+      fprintf(stderr, "INFO: %zu function(s) recognised from signatures\n", n);
+    }
     printf("start: %08lx\nend: %08lx\nsize:%08lx\nstorage: %08lx\n",
-           start_idx, end_idx, end_idx - start_idx, mem.size());
+           start_idx, end_idx, end_idx - start_idx, storage);
     fflush(stdout);
 
-    dis86_t *d = dis86_new(start_idx, mem.segment(start_idx, end_idx - start_idx));
+    dis86_t *d = relocs ? dis86_new_view(start_idx, region, relocs) : dis86_new(start_idx, region);
 
     if (!d)
       FAIL("Failed to allocate dis86 instance");
 
     dis_exit = d;
 
-    array_t *ins_arr = array_new(sizeof(dis86_instr_t));
-    while (1) {
-      dis86_instr_t *ins = dis86_next(d);
-      if (!ins) break;
+    db_t *db = nullptr;
+    if (opt->db) {
+      db = db_open(opt->db);
+      if (!db) FAIL("Failed to open project database: '%s'", opt->db);
+    }
 
-      dis86_instr_t *ins_ptr = (dis86_instr_t*)array_append_dst(ins_arr);
-      dis86_instr_copy(ins_ptr, ins);
+    // Decoding depends only on the bytes and which of them the loader patches
+    uint64_t ins_key = hash_u64(HASH_INIT, DB_FORMAT_VERSION);
+    ins_key = hash_u64(ins_key, start_idx);
+    ins_key = hash_u64(ins_key, end_idx);
+    ins_key = hash_bytes(ins_key, region.data(), region.size());
+    if (relocs) {
+      for (uint32_t addr : relocs->addrs) {
+        if (addr + 1 >= start_idx && addr < end_idx) ins_key = hash_u64(ins_key, addr);
+      }
+    }
+
+    static_assert(std::is_trivially_copyable_v<dis86_instr_t>);
+    array_t *ins_arr = array_new(sizeof(dis86_instr_t));
+    std::string rec;
+    {
+      STAT_TIMER("decomp.decode");
+      if (db && db_get(db, "ins", ins_key, &rec) && rec.size() % sizeof(dis86_instr_t) == 0) {
+        for (size_t off = 0; off < rec.size(); off += sizeof(dis86_instr_t)) {
+          memcpy(array_append_dst(ins_arr), rec.data() + off, sizeof(dis86_instr_t));
+        }
+      } else {
+        while (1) {
+          dis86_instr_t *ins = dis86_next(d);
+          if (!ins) break;
+
+          dis86_instr_t *ins_ptr = (dis86_instr_t*)array_append_dst(ins_arr);
+          dis86_instr_copy(ins_ptr, ins);
+        }
+        if (db) {
+          size_t n = 0;
+          void *data = array_borrow(ins_arr, &n);
+          db_put(db, "ins", ins_key, data, n * sizeof(dis86_instr_t));
+        }
+      }
     }
 
     size_t n_instr = 0;
@@ -111,13 +191,26 @@ namespace decompiler
     char func_name[256];
     sprintf(func_name, "func_%08x__%04x_%04x", (uint32_t)start_idx, opt->start.seg, opt->start.off);
 
-    std::string s = dis86_decompile(d, cfg, func_name, opt->start.seg, instr, n_instr);
+    // The emitted code additionally depends on the config entries this
+    // function consults, and on its name and segment
+    uint64_t code_key = hash_u64(ins_key, dis86_decompile_config_deps_hash(cfg, opt->start.seg, instr, n_instr));
+    code_key = hash_str(code_key, func_name);
+    code_key = hash_u64(code_key, opt->start.seg);
+
+    std::string s;
+    if (!db || !db_get(db, "code", code_key, &s)) {
+      s = dis86_decompile(d, cfg, func_name, opt->start.seg, instr, n_instr);
+      if (db) db_put(db, "code", code_key, s.data(), s.size());
+    }
     printf("%-30s\n", s.c_str());
 
     dis_exit = nullptr;
+    db_close(db);
     dis86_decompile_config_delete(cfg);
     array_delete(ins_arr);
     dis86_delete(d);
+
+    if (opt->stats || opt->stats_json) stats_print(stderr, opt->stats_json);
     return 0;
   }
 }
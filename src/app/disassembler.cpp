@@ -4,6 +4,7 @@
 #include "cmdarg/cmdarg.h"
 
 #include "common/common.h"
+#include "common/stats.h"
 #include <cstdint>
 #include <string>
 
@@ -21,9 +22,12 @@ namespace disassembler
     fprintf(f, "usage: %s dis OPTIONS\n", appname);
     fprintf(stderr, "\n");
     fprintf(stderr, "OPTIONS:\n");
-    fprintf(stderr, "  --binary       path to binary on the filesystem (required)\n");
+    fprintf(stderr, "  --binary       path to raw binary on the filesystem (this or --exe required)\n");
+    fprintf(stderr, "  --exe          path to MZ executable, addresses relative to its load image\n");
     fprintf(stderr, "  --start-addr   start seg:off address (required)\n");
     fprintf(stderr, "  --end-addr     end seg:off address (required)\n");
+    fprintf(stderr, "  --stats        print decoder counters and timings to stderr (optional)\n");
+    fprintf(stderr, "  --stats-json   as --stats, formatted as JSON (optional)\n");
   }
 
   static bool cmdarg_segoff(int * argc, char *** argv, const char * name, segoff_t *_out)
@@ -40,12 +44,20 @@ namespace disassembler
     atexit(on_fail);
 
     const char * binary = nullptr;
+    const char * exe    = nullptr;
     segoff_t     start  = {};
     segoff_t     end    = {};
 
+    bool         stats      = false;
+    bool         stats_json = false;
+
     bool found;
 
+    cmdarg_option(&argc, &argv, "--stats", &stats);
+    cmdarg_option(&argc, &argv, "--stats-json", &stats_json);
+
     found = cmdarg_string(&argc, &argv, "--binary", &binary);
+    found = cmdarg_string(&argc, &argv, "--exe", &exe) || found;
     if (!found) { print_help(stderr, argv[0]); return 3; }
 
     found = cmdarg_segoff(&argc, &argv, "--start-addr", &start);
@@ -57,24 +69,38 @@ namespace disassembler
     size_t start_idx = segoff_abs(start);
     size_t end_idx = segoff_abs(end);
 
-    dynarray mem = read_file(binary);
-
-    dis86_t *d = dis86_new(start_idx, mem.segment(start_idx, end_idx - start_idx));
+    dynarray mem;
+    dos::executable_t exe_file;
+    dis86_t *d = nullptr;
+    if (exe) {
+      if (!exe_file.open(exe)) FAIL("Failed to load MZ executable: '%s'", exe);
+      if (end_idx > exe_file.image.size()) FAIL("End address is beyond the load image");
+      d = dis86_new_view(start_idx, exe_file.image.slice(start_idx, end_idx - start_idx), &exe_file.relocs);
+    } else {
+      mem = read_file(binary);
+      d = dis86_new(start_idx, mem.segment(start_idx, end_idx - start_idx));
+    }
     if (!d) FAIL("Failed to allocate dis86 instance");
 
     dis_exit = d;
 
-    std::string s;
-    dis86_instr_t* ins = nullptr;
-    while (ins = dis86_next(d), ins != nullptr)
     {
-      s = dis86_print_intel_syntax(d, ins, true);
-      printf("%s\n", s.c_str());
-      s.clear();
+      STAT_TIMER("dis.total");
+      std::string s;
+      dis86_instr_t* ins = nullptr;
+      while (ins = dis86_next(d), ins != nullptr)
+      {
+        s = dis86_print_intel_syntax(d, ins, true);
+        printf("%s\n", s.c_str());
+        STAT_ADD(EMIT_BYTES, s.size() + 1);
+        s.clear();
+      }
     }
 
     dis_exit = nullptr;
     dis86_delete(d);
+
+    if (stats || stats_json) stats_print(stderr, stats_json);
     return 0;
   }
 }
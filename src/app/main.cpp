@@ -9,6 +9,10 @@ namespace decompiler
 {
   extern int main(int argc, char *argv[]);
 }
+namespace server
+{
+  extern int main(int argc, char *argv[]);
+}
 
 static void print_help(FILE *f, const char *appname)
 {
@@ -17,6 +21,7 @@ static void print_help(FILE *f, const char *appname)
   fprintf(stderr, "MODES:\n");
   fprintf(stderr, "  dis       disassemble the binary and emit intel syntax\n");
   fprintf(stderr, "  decomp    decompile the binary\n");
+  fprintf(stderr, "  serve     keep the binary and config loaded and answer dis/decomp requests\n");
 }
 
 int main(int argc, char *argv[])
@@ -30,6 +35,7 @@ int main(int argc, char *argv[])
   if (0) {}
   else if (0 == strcmp(mode, "dis"))    return disassembler::main(argc, argv);
   else if (0 == strcmp(mode, "decomp")) return decompiler::main(argc, argv);
+  else if (0 == strcmp(mode, "serve"))  return server::main(argc, argv);
 
   fprintf(stderr, "Error: Unknown mode '%s'", mode);
   print_help(stderr, argv[0]);
@@ -0,0 +1,394 @@
+#include "dis86.h"
+#include "segoff.h"
+#include "cmdarg/cmdarg.h"
+
+#include "common/common.h"
+#include "common/fail.h"
+#include "common/mapped_file.h"
+#include "common/stats.h"
+#include <cstdint>
+#include <format>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// Long-running server: loads the binary and config once and answers requests
+// against them, so editor plugins and viewers don't pay for a process start,
+// a config parse and a full decode on every save.
+//
+// Kept resident between requests:
+//   - the mapped binary (or MZ load image and its relocation index)
+//   - the parsed config, and with it the decompile memo and its symbols
+//   - the decoded instructions of every range asked for so far
+//
+// The config file is checked before each request and re-read when it has
+// changed on disk. Only the cached decompilations that consult an edited
+// function, global or segmap are dropped, so an annotation edit in a large
+// project costs a handful of functions rather than all of them.
+//
+// Protocol: one request per line, each answered with a header line and a
+// payload of exactly the announced length (so the payload may span lines):
+//
+//   dis    <start seg:off> <end seg:off>     ->  ok <n>\n<n bytes of assembly>
+//   decomp <start seg:off> <end seg:off>     ->  ok <n>\n<n bytes of C>
+//   stats                                    ->  ok <n>\n<n bytes of JSON>
+//   reload                                   ->  ok <n>\n<n bytes summarising the change>
+//   quit                                     ->  ok 0\n, then the server exits
+//
+// Anything that goes wrong with a request (a bad address, undecodable bytes,
+// a function the decompiler can't handle) is answered with
+// 'error <n>\n<message>' and the server carries on.
+
+#define MAX_CACHED_RANGES 4096  /* decoded ranges kept before the cache is flushed */
+
+namespace server
+{
+  static void print_help(FILE *f, const char *appname)
+  {
+    fprintf(f, "usage: %s serve OPTIONS\n", appname);
+    fprintf(f, "\n");
+    fprintf(f, "OPTIONS:\n");
+    fprintf(f, "  --binary       path to raw binary on the filesystem (this or --exe required)\n");
+    fprintf(f, "  --exe          path to MZ executable, addresses relative to its load image\n");
+    fprintf(f, "  --config       path to configuration file (.bsl) (optional)\n");
+    fprintf(f, "  --sigs         library signature file (.bsl), applied to each segment on first use (optional)\n");
+    fprintf(f, "  --socket       listen on this Unix socket path instead of stdin/stdout (optional)\n");
+    fprintf(f, "\n");
+    fprintf(f, "REQUESTS (one per line):\n");
+    fprintf(f, "  dis <start seg:off> <end seg:off>\n");
+    fprintf(f, "  decomp <start seg:off> <end seg:off>\n");
+    fprintf(f, "  stats\n");
+    fprintf(f, "  reload   (re-read the config now; it is also re-read whenever it changes)\n");
+    fprintf(f, "  quit\n");
+  }
+
+  typedef struct range range_t;
+  struct range
+  {
+    dis86_t *                  d;
+    std::vector<dis86_instr_t> ins;
+    dis86_error_t              err;  /* err.msg[0] set if the range doesn't decode */
+  };
+
+  typedef struct server server_t;
+  struct server
+  {
+    mapped_file                             file;
+    dos::executable_t                       exe;
+    segment<uint8_t>                        image;
+    const dos::relocation_index_t *         relocs;
+
+    dis86_decompile_config_t *              cfg;
+    const char *                            config;
+    struct stat                             config_st;  /* as last read */
+    const char *                            sigs;
+    std::set<uint16_t>                      sigs_applied;
+
+    std::unordered_map<uint64_t, range_t*>  ranges;
+  };
+
+  static void server_flush_ranges(server_t *s)
+  {
+    for (auto& it : s->ranges) {
+      dis86_delete(it.second->d);
+      delete it.second;
+    }
+    s->ranges.clear();
+  }
+
+  static range_t * server_range(server_t *s, size_t start_idx, size_t end_idx)
+  {
+    uint64_t key = (uint64_t)start_idx << 32 | end_idx;
+    auto it = s->ranges.find(key);
+    if (it != s->ranges.end()) return it->second;
+
+    if (s->ranges.size() >= MAX_CACHED_RANGES) server_flush_ranges(s);
+
+    range_t *r = new range_t();
+    r->d = dis86_new_view(start_idx, s->image.slice(start_idx, end_idx - start_idx), s->relocs);
+    if (!r->d) FAIL("Failed to allocate dis86 instance");
+
+    STAT_TIMER("serve.decode");
+    while (1) {
+      dis86_instr_t *ins = nullptr;
+      dis86_status_t st = dis86_next_checked(r->d, &ins, &r->err);
+      if (st == DIS86_END) break;
+      if (st == DIS86_ERROR) break;
+      r->ins.push_back(*ins);
+    }
+
+    s->ranges[key] = r;
+    return r;
+  }
+
+  static bool server_emit_dis(server_t *s, range_t *r, std::string *out)
+  {
+    for (dis86_instr_t& ins : r->ins) {
+      *out += dis86_print_intel_syntax(r->d, &ins, true);
+      *out += '\n';
+    }
+    return true;
+  }
+
+  static bool server_emit_decomp(server_t *s, range_t *r, segoff_t start, std::string *out)
+  {
+    if (s->sigs && s->sigs_applied.insert(start.seg).second) {
+      dis86_decompile_config_apply_signatures(s->cfg, s->sigs, s->image, 0, start.seg);
+    }
+
+    char func_name[256];
+    sprintf(func_name, "func_%08x__%04x_%04x", (uint32_t)segoff_abs(start), start.seg, start.off);
+
+    dis86_error_t err[1] = {};
+    dis86_status_t st = dis86_decompile_checked(r->d, s->cfg, func_name, start.seg,
+                                                r->ins.data(), r->ins.size(), out, err);
+    if (st != DIS86_OK) {
+      *out = std::format<"decompile failed at 0x%zx: %s">(err->addr, err->msg);
+      return false;
+    }
+    return true;
+  }
+
+  static bool server_emit_stats(std::string *out)
+  {
+    char *buf = nullptr;
+    size_t len = 0;
+    FILE *f = open_memstream(&buf, &len);
+    if (!f) { *out = "failed to open memory stream"; return false; }
+    stats_print(f, true);
+    fclose(f);
+    out->assign(buf, len);
+    free(buf);
+    return true;
+  }
+
+  static void reply(FILE *out, bool ok, const std::string& payload)
+  {
+    fprintf(out, "%s %zu\n", ok ? "ok" : "error", payload.size());
+    fwrite(payload.data(), 1, payload.size(), out);
+    fflush(out);
+  }
+
+  static bool config_changed(const struct stat *a, const struct stat *b)
+  {
+    return a->st_ino != b->st_ino || a->st_size != b->st_size ||
+      a->st_mtim.tv_sec != b->st_mtim.tv_sec || a->st_mtim.tv_nsec != b->st_mtim.tv_nsec;
+  }
+
+  // Re-reads the config and carries over whatever of the cache it can. On
+  // failure the previous config stays in use.
+  static bool server_reload(server_t *s, std::string *out)
+  {
+    if (!s->config) { *out = "no config file"; return false; }
+
+    struct stat st;
+    if (stat(s->config, &st) < 0) {
+      *out = std::format<"failed to stat '%s': %s">(s->config, strerror(errno));
+      return false;
+    }
+    s->config_st = st;  /* don't retry a broken file until it changes again */
+
+    dis86_error_t err[1] = {};
+    dis86_decompile_config_t *cfg = dis86_decompile_config_read_checked(s->config, err);
+    if (!cfg) {
+      *out = std::format<"failed to reload '%s': %s">(s->config, err->msg);
+      return false;
+    }
+    for (uint16_t seg : s->sigs_applied) {
+      dis86_decompile_config_apply_signatures(cfg, s->sigs, s->image, 0, seg);
+    }
+
+    dis86_decompile_config_diff_t diff[1];
+    dis86_decompile_config_take_cache(cfg, s->cfg, diff);
+    dis86_decompile_config_delete(s->cfg);
+    s->cfg = cfg;
+
+    *out = std::format<"reloaded '%s': %zu function(s), %zu global(s), %zu segmap(s) changed; "
+                       "%zu cached decompilation(s) kept, %zu invalidated">(
+                         s->config, diff->funcs, diff->globals, diff->segmaps, diff->kept, diff->invalidated);
+    return true;
+  }
+
+  static void server_check_config(server_t *s)
+  {
+    struct stat st;
+    if (!s->config || stat(s->config, &st) < 0 || !config_changed(&st, &s->config_st)) return;
+
+    std::string msg;
+    bool ok = server_reload(s, &msg);
+    fprintf(stderr, "%s: %s\n", ok ? "INFO" : "WARN", msg.c_str());
+  }
+
+  // Answers one request line. Returns false when asked to quit.
+  static bool server_request(server_t *s, char *line, FILE *out)
+  {
+    const char *args[4] = {};
+    size_t n_args = 0;
+    char *save = nullptr;
+    for (char *tok = strtok_r(line, " \t\r\n", &save); tok; tok = strtok_r(nullptr, " \t\r\n", &save)) {
+      if (n_args == ARRAY_SIZE(args)) { reply(out, false, "too many arguments"); return true; }
+      args[n_args++] = tok;
+    }
+    if (n_args == 0) return true;  /* blank line */
+
+    const char *cmd = args[0];
+    std::string payload;
+
+    if (0 == strcmp(cmd, "quit")) { reply(out, true, ""); return false; }
+    if (0 == strcmp(cmd, "stats")) {
+      bool ok = server_emit_stats(&payload);
+      reply(out, ok, payload);
+      return true;
+    }
+    if (0 == strcmp(cmd, "reload")) {
+      bool ok = server_reload(s, &payload);
+      reply(out, ok, payload);
+      return true;
+    }
+
+    bool is_dis = 0 == strcmp(cmd, "dis");
+    if (!is_dis && 0 != strcmp(cmd, "decomp")) {
+      reply(out, false, std::format<"unknown request '%s'">(cmd));
+      return true;
+    }
+    if (n_args != 3) {
+      reply(out, false, std::format<"usage: %s <start seg:off> <end seg:off>">(cmd));
+      return true;
+    }
+
+    segoff_t start, end;
+    try {
+      fail_recover recover;
+      start = parse_segoff(args[1]);
+      end   = parse_segoff(args[2]);
+    } catch (const fail_error& e) {
+      reply(out, false, e.msg);
+      return true;
+    }
+
+    size_t start_idx = segoff_abs(start);
+    size_t end_idx   = segoff_abs(end);
+    if (start_idx > end_idx || end_idx > s->image.size()) {
+      reply(out, false, std::format<"range %05zx-%05zx is outside the image (size %05zx)">(
+                          start_idx, end_idx, s->image.size()));
+      return true;
+    }
+
+    server_check_config(s);
+
+    range_t *r = server_range(s, start_idx, end_idx);
+    if (r->err.msg[0]) {
+      reply(out, false, std::format<"decode failed at 0x%zx: %s">(r->err.addr, r->err.msg));
+      return true;
+    }
+
+    bool ok = is_dis ? server_emit_dis(s, r, &payload) : server_emit_decomp(s, r, start, &payload);
+    reply(out, ok, payload);
+    return true;
+  }
+
+  // Serves requests until end of input or 'quit'. Returns false on 'quit'.
+  static bool server_session(server_t *s, FILE *in, FILE *out)
+  {
+    char *line = nullptr;
+    size_t cap = 0;
+    bool more = true;
+    while (more && getline(&line, &cap, in) >= 0) {
+      more = server_request(s, line, out);
+    }
+    free(line);
+    return more;
+  }
+
+  static int server_listen(server_t *s, const char *path)
+  {
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) FAIL("Socket path too long: '%s'", path);
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) FAIL("Failed to create socket: %s", strerror(errno));
+    unlink(path);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) FAIL("Failed to bind '%s': %s", path, strerror(errno));
+    if (listen(fd, 8) < 0) FAIL("Failed to listen on '%s': %s", path, strerror(errno));
+
+    // A client hanging up mid-reply must not take the server down
+    signal(SIGPIPE, SIG_IGN);
+
+    // Clients are served one at a time: requests are cheap and the caches
+    // aren't shared across threads
+    bool more = true;
+    while (more) {
+      int conn = accept(fd, nullptr, nullptr);
+      if (conn < 0) {
+        if (errno == EINTR) continue;
+        FAIL("Failed to accept on '%s': %s", path, strerror(errno));
+      }
+      FILE *in  = fdopen(conn, "r");
+      FILE *out = fdopen(dup(conn), "w");
+      if (!in || !out) FAIL("Failed to open connection streams");
+      more = server_session(s, in, out);
+      fclose(out);
+      fclose(in);
+    }
+
+    close(fd);
+    unlink(path);
+    return 0;
+  }
+
+  int main(int argc, char *argv[])
+  {
+    const char * binary = nullptr;
+    const char * exe    = nullptr;
+    const char * config = nullptr;
+    const char * sigs   = nullptr;
+    const char * sock   = nullptr;
+    bool found;
+
+    found = cmdarg_string(&argc, &argv, "--config", &config);
+    (void)found; /* optional */
+
+    found = cmdarg_string(&argc, &argv, "--sigs", &sigs);
+    (void)found; /* optional */
+
+    found = cmdarg_string(&argc, &argv, "--socket", &sock);
+    (void)found; /* optional */
+
+    found = cmdarg_string(&argc, &argv, "--binary", &binary);
+    found = cmdarg_string(&argc, &argv, "--exe", &exe) || found;
+    if (!found) { print_help(stderr, argv[0]); return 3; }
+
+    server_t *s = new server_t();
+    if (exe) {
+      if (!s->exe.open(exe)) FAIL("Failed to load MZ executable: '%s'", exe);
+      s->image  = s->exe.image;
+      s->relocs = &s->exe.relocs;
+    } else {
+      if (!s->file.open(binary)) FAIL("Failed to map binary: '%s'", binary);
+      s->image = s->file.segment(0, s->file.size());
+    }
+
+    if (config && stat(config, &s->config_st) < 0) FAIL("Failed to read config file: '%s'", config);
+    s->cfg = config ? dis86_decompile_config_read_new(config) : dis86_decompile_config_default_new();
+    if (!s->cfg) FAIL("Failed to read config file: '%s'", config);
+    s->config = config;
+    s->sigs = sigs;
+
+    int ret = 0;
+    if (sock) ret = server_listen(s, sock);
+    else      server_session(s, stdin, stdout);
+
+    server_flush_ranges(s);
+    dis86_decompile_config_delete(s->cfg);
+    delete s;
+    return ret;
+  }
+}
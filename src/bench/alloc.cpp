@@ -0,0 +1,92 @@
+#include "bench.h"
+
+// Heap accounting for the benchmarks
+//
+// On glibc the executable may define malloc and friends itself and forward
+// to the __libc_* entry points, which is enough to see every allocation the
+// library makes (operator new goes through malloc too). Elsewhere the
+// counters stay at zero and alloc_tracking() says so.
+
+static size_t g_current = 0;
+static size_t g_peak    = 0;
+
+#ifdef __GLIBC__
+#include <malloc.h>
+
+extern "C" {
+  void * __libc_malloc(size_t);
+  void * __libc_calloc(size_t, size_t);
+  void * __libc_realloc(void *, size_t);
+  void   __libc_free(void *);
+  void * __libc_memalign(size_t, size_t);
+}
+
+static inline void account_add(void *p)
+{
+  if (!p) return;
+  g_current += malloc_usable_size(p);
+  if (g_current > g_peak) g_peak = g_current;
+}
+
+static inline void account_sub(void *p)
+{
+  if (p) g_current -= malloc_usable_size(p);
+}
+
+extern "C" void * malloc(size_t n)
+{
+  void *p = __libc_malloc(n);
+  account_add(p);
+  return p;
+}
+
+extern "C" void * calloc(size_t n, size_t sz)
+{
+  void *p = __libc_calloc(n, sz);
+  account_add(p);
+  return p;
+}
+
+extern "C" void * realloc(void *old, size_t n)
+{
+  account_sub(old);
+  void *p = __libc_realloc(old, n);
+  account_add(p ? p : (n ? old : nullptr));
+  return p;
+}
+
+extern "C" void free(void *p)
+{
+  account_sub(p);
+  __libc_free(p);
+}
+
+extern "C" void * memalign(size_t align, size_t n)
+{
+  void *p = __libc_memalign(align, n);
+  account_add(p);
+  return p;
+}
+
+extern "C" int posix_memalign(void **out, size_t align, size_t n)
+{
+  void *p = __libc_memalign(align, n);
+  if (!p) return 12; // ENOMEM
+  account_add(p);
+  *out = p;
+  return 0;
+}
+
+extern "C" void * aligned_alloc(size_t align, size_t n)
+{
+  return memalign(align, n);
+}
+
+bool alloc_tracking(void) { return true; }
+#else
+bool alloc_tracking(void) { return false; }
+#endif
+
+size_t alloc_current(void)    { return g_current; }
+size_t alloc_peak(void)       { return g_peak; }
+void   alloc_reset_peak(void) { g_peak = g_current; }
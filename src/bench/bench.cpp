@@ -0,0 +1,324 @@
+#include "bench.h"
+#include "encode.h"
+#include "instr.h"
+#include "cmdarg/cmdarg.h"
+#include "common/common.h"
+
+#include <chrono>
+#include <random>
+
+// Decoder throughput benchmarks
+//
+// Each benchmark runs its body in batches, doubling the batch until one takes
+// at least --min-time, and reports the time per item from that batch. The
+// byte streams are synthetic but only contain encodings the decoder accepts,
+// built by drawing from the instruction table; --binary adds a real code
+// region to the set.
+//
+// Output is a table by default, or JSON shaped like Google Benchmark's with
+// --json so that results can be diffed between runs.
+//
+// --decompile switches to the end-to-end suite in bench_decompile.cpp.
+
+#define STREAM_BYTES (256*1024)
+
+typedef struct stream stream_t;
+struct stream
+{
+  const char *         name;
+  std::vector<uint8_t> bytes;
+};
+
+static void print_help(FILE *f, const char *appname)
+{
+  fprintf(f, "usage: %s [OPTIONS]\n", appname);
+  fprintf(f, "\n");
+  fprintf(f, "OPTIONS:\n");
+  fprintf(f, "  --json         emit results as JSON on stdout\n");
+  fprintf(f, "  --filter       only run benchmarks whose name contains this string\n");
+  fprintf(f, "  --min-time     minimum seconds per measured batch (default 0.5)\n");
+  fprintf(f, "  --seed         seed for the synthetic streams (default 1)\n");
+  fprintf(f, "  --binary       raw code region to benchmark as the 'real' stream (optional)\n");
+  fprintf(f, "  --decompile    run the end-to-end decompiler suite with a per-phase breakdown instead\n");
+}
+
+/*****************************************************************/
+/* STREAMS */
+/*****************************************************************/
+
+// Appends one instruction built from 'fmt', letting the decoder decide how
+// many of the random trailing bytes belong to it
+static void emit_instr(std::vector<uint8_t>& out, std::mt19937& rng, const instr_fmt_t *fmt,
+                       size_t n_prefix, bool force_disp)
+{
+  uint8_t buf[ENCODE_MAX];
+  auto next = [&]() { return rng(); };
+  size_t len = encode_instr(buf, fmt, n_prefix, force_disp, next, next);
+  out.insert(out.end(), buf, buf + len);
+}
+
+static stream_t make_stream(const char *name, uint32_t seed, bool modrm_only, size_t max_prefix, bool force_disp)
+{
+  std::mt19937 rng(seed);
+  std::vector<const instr_fmt_t*> fmts = valid_fmts(modrm_only);
+
+  stream_t s;
+  s.name = name;
+  while (s.bytes.size() < STREAM_BYTES) {
+    size_t n_prefix = max_prefix ? 1 + rng() % max_prefix : 0;
+    emit_instr(s.bytes, rng, fmts[rng() % fmts.size()], n_prefix, force_disp);
+  }
+  return s;
+}
+
+/*****************************************************************/
+/* HARNESS */
+/*****************************************************************/
+
+typedef uint64_t (*bench_fn_t)(const void *arg, uint64_t batch); /* returns items processed */
+
+double                 g_min_time = 0.5;
+static volatile size_t g_sink;
+
+static result_t run_bench(const std::string& name, bench_fn_t fn, const void *arg)
+{
+  using clock = std::chrono::steady_clock;
+
+  fn(arg, 1); // warm up
+
+  for (uint64_t batch = 1; ; batch *= 2) {
+    auto t0 = clock::now();
+    uint64_t items = fn(arg, batch);
+    double secs = std::chrono::duration<double>(clock::now() - t0).count();
+    if (secs >= g_min_time || batch >= (1ull << 40)) {
+      result_t r;
+      r.name          = name;
+      r.iterations    = items;
+      r.ns_per_item   = secs * 1e9 / (double)items;
+      r.items_per_sec = (double)items / secs;
+      r.peak_bytes    = -1;
+      return r;
+    }
+  }
+}
+
+/*****************************************************************/
+/* BENCHMARKS */
+/*****************************************************************/
+
+// batch = passes over the stream
+static uint64_t bench_decode(const void *arg, uint64_t batch)
+{
+  const stream_t *s = (const stream_t*)arg;
+  uint64_t n = 0;
+  for (uint64_t i = 0; i < batch; i++) {
+    dis86_t *d = dis86_new_view(0, segment<uint8_t>((uint8_t*)s->bytes.data(), s->bytes.size()), nullptr);
+    while (dis86_instr_t *ins = dis86_next(d)) {
+      g_sink = g_sink + ins->n_bytes;
+      n++;
+    }
+    dis86_delete(d);
+  }
+  return n;
+}
+
+typedef struct lookup_set lookup_set_t;
+struct lookup_set
+{
+  std::vector<uint8_t> opcode1;
+  std::vector<uint8_t> opcode2;  /* DNE (0xff) when the first lookup suffices */
+};
+
+// batch = passes over the lookups the decoder made for the stream
+static uint64_t bench_fmt_lookup(const void *arg, uint64_t batch)
+{
+  const lookup_set_t *l = (const lookup_set_t*)arg;
+  uint64_t n = 0;
+  for (uint64_t i = 0; i < batch; i++) {
+    for (size_t j = 0; j < l->opcode1.size(); j++) {
+      instr_fmt_t *fmt = nullptr;
+      int ret = instr_fmt_lookup(l->opcode1[j], 0xff, &fmt);
+      if (ret == RESULT_NEED_OPCODE2) ret = instr_fmt_lookup(l->opcode1[j], l->opcode2[j], &fmt);
+      g_sink = g_sink + (size_t)fmt;
+      n++;
+    }
+  }
+  return n;
+}
+
+typedef struct decoded decoded_t;
+struct decoded
+{
+  std::vector<uint8_t>       bytes;
+  std::vector<dis86_instr_t> ins;
+};
+
+// batch = passes over the decoded stream
+static uint64_t bench_print_intel(const void *arg, uint64_t batch)
+{
+  const decoded_t *dec = (const decoded_t*)arg;
+  dis86_t *d = dis86_new_view(0, segment<uint8_t>((uint8_t*)dec->bytes.data(), dec->bytes.size()), nullptr);
+  uint64_t n = 0;
+  for (uint64_t i = 0; i < batch; i++) {
+    for (const dis86_instr_t& ins : dec->ins) {
+      g_sink = g_sink + dis86_print_intel_syntax(d, (dis86_instr_t*)&ins, false).size();
+      n++;
+    }
+  }
+  dis86_delete(d);
+  return n;
+}
+
+static lookup_set_t collect_lookups(const stream_t *s)
+{
+  lookup_set_t l;
+  dis86_t *d = dis86_new_view(0, segment<uint8_t>((uint8_t*)s->bytes.data(), s->bytes.size()), nullptr);
+  size_t pos = 0;
+  while (dis86_instr_t *ins = dis86_next(d)) {
+    size_t p = pos;
+    while (is_prefix(s->bytes[p])) p++;
+    uint8_t op1 = s->bytes[p];
+    uint8_t op2 = p+1 < s->bytes.size() ? (s->bytes[p+1] >> 3) & 7 : 0;
+    instr_fmt_t *fmt;
+    l.opcode1.push_back(op1);
+    l.opcode2.push_back(instr_fmt_lookup(op1, 0xff, &fmt) == RESULT_NEED_OPCODE2 ? op2 : 0xff);
+    pos += ins->n_bytes;
+  }
+  dis86_delete(d);
+  return l;
+}
+
+static decoded_t collect_decoded(const stream_t *s)
+{
+  decoded_t dec;
+  dec.bytes = s->bytes;
+  dis86_t *d = dis86_new_view(0, segment<uint8_t>(dec.bytes.data(), dec.bytes.size()), nullptr);
+  while (dis86_instr_t *ins = dis86_next(d)) dec.ins.push_back(*ins);
+  dis86_delete(d);
+  return dec;
+}
+
+/*****************************************************************/
+/* OUTPUT */
+/*****************************************************************/
+
+void print_table(const std::vector<result_t>& results)
+{
+  bool with_peak = false;
+  for (const result_t& r : results) with_peak |= r.peak_bytes >= 0;
+
+  printf("%-40s %12s %14s %16s", "Benchmark", "Items", "ns/item", "items/s");
+  if (with_peak) printf(" %14s", "peak bytes");
+  printf("\n");
+  printf("%.*s\n", with_peak ? 100 : 85, "----------------------------------------------------------------------------------------------------");
+  for (const result_t& r : results) {
+    printf("%-40s %12llu %14.2f %16.0f", r.name.c_str(), (unsigned long long)r.iterations,
+           r.ns_per_item, r.items_per_sec);
+    if (r.peak_bytes >= 0) printf(" %14lld", (long long)r.peak_bytes);
+    printf("\n");
+  }
+}
+
+void print_json(const std::vector<result_t>& results, uint32_t seed)
+{
+  printf("{\n");
+  printf("  \"context\": {\n");
+  printf("    \"executable\": \"dis86_bench\",\n");
+  printf("    \"seed\": %u,\n", seed);
+  printf("    \"min_time\": %g,\n", g_min_time);
+#ifdef NDEBUG
+  printf("    \"library_build_type\": \"release\"\n");
+#else
+  printf("    \"library_build_type\": \"debug\"\n");
+#endif
+  printf("  },\n");
+  printf("  \"benchmarks\": [\n");
+  for (size_t i = 0; i < results.size(); i++) {
+    const result_t& r = results[i];
+    printf("    {\n");
+    printf("      \"name\": \"%s\",\n", r.name.c_str());
+    printf("      \"iterations\": %llu,\n", (unsigned long long)r.iterations);
+    printf("      \"real_time\": %.4f,\n", r.ns_per_item);
+    printf("      \"time_unit\": \"ns\",\n");
+    printf("      \"items_per_second\": %.1f%s\n", r.items_per_sec, r.peak_bytes >= 0 ? "," : "");
+    if (r.peak_bytes >= 0) printf("      \"peak_bytes\": %lld\n", (long long)r.peak_bytes);
+    printf("    }%s\n", i+1 < results.size() ? "," : "");
+  }
+  printf("  ]\n");
+  printf("}\n");
+}
+
+/*****************************************************************/
+/* MAIN */
+/*****************************************************************/
+
+int main(int argc, char *argv[])
+{
+  bool help = false;
+  cmdarg_option(&argc, &argv, "--help", &help);
+  if (help) { print_help(stdout, argv[0]); return 0; }
+
+  bool json = false;
+  cmdarg_option(&argc, &argv, "--json", &json);
+
+  const char *filter = nullptr;
+  cmdarg_string(&argc, &argv, "--filter", &filter);
+
+  const char *min_time = nullptr;
+  if (cmdarg_string(&argc, &argv, "--min-time", &min_time)) g_min_time = atof(min_time);
+
+  uint64_t seed = 1;
+  cmdarg_uint64_t(&argc, &argv, "--seed", &seed);
+
+  const char *binary = nullptr;
+  cmdarg_string(&argc, &argv, "--binary", &binary);
+
+  bool decompile = false;
+  cmdarg_option(&argc, &argv, "--decompile", &decompile);
+
+  if (argc != 1) { print_help(stderr, argv[0]); return 3; }
+
+  if (decompile) {
+    std::vector<result_t> results = bench_decompile(filter, (uint32_t)seed);
+    if (json) print_json(results, (uint32_t)seed);
+    else      print_table(results);
+    return 0;
+  }
+
+  std::vector<stream_t> streams;
+  streams.push_back(make_stream("random", (uint32_t)seed,   false, 0, false));
+  streams.push_back(make_stream("prefix", (uint32_t)seed+1, false, 3, false));
+  streams.push_back(make_stream("modrm",  (uint32_t)seed+2, true,  0, true));
+  if (binary) {
+    dynarray mem = read_file(binary);
+    if (mem.empty()) FAIL("Failed to read file: '%s'", binary);
+    stream_t s;
+    s.name = "real";
+    s.bytes.assign(mem.data(), mem.data() + mem.size());
+    streams.push_back(std::move(s));
+  }
+
+  auto wanted = [&](const std::string& name) { return !filter || name.find(filter) != std::string::npos; };
+
+  std::vector<result_t> results;
+  for (const stream_t& s : streams) {
+    std::string name = std::string("decode/") + s.name;
+    if (wanted(name)) results.push_back(run_bench(name, bench_decode, &s));
+  }
+  for (const stream_t& s : streams) {
+    std::string name = std::string("fmt_lookup/") + s.name;
+    if (!wanted(name)) continue;
+    lookup_set_t l = collect_lookups(&s);
+    results.push_back(run_bench(name, bench_fmt_lookup, &l));
+  }
+  for (const stream_t& s : streams) {
+    std::string name = std::string("print_intel/") + s.name;
+    if (!wanted(name)) continue;
+    decoded_t dec = collect_decoded(&s);
+    results.push_back(run_bench(name, bench_print_intel, &dec));
+  }
+
+  if (json) print_json(results, (uint32_t)seed);
+  else      print_table(results);
+  return 0;
+}
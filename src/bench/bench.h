@@ -0,0 +1,30 @@
+#pragma once
+#include "header.h"
+#include "dis86.h"
+
+#include <string>
+#include <vector>
+
+typedef struct result result_t;
+struct result
+{
+  std::string name;
+  uint64_t    iterations;     /* items processed in the measured batch */
+  double      ns_per_item;
+  double      items_per_sec;
+  int64_t     peak_bytes;     /* -1 when not measured */
+};
+
+extern double g_min_time;
+
+void print_table(const std::vector<result_t>& results);
+void print_json(const std::vector<result_t>& results, uint32_t seed);
+
+/* bench_decompile.cpp */
+std::vector<result_t> bench_decompile(const char *filter, uint32_t seed);
+
+/* alloc.cpp: heap accounting, when the platform lets us interpose malloc */
+bool   alloc_tracking(void);
+size_t alloc_current(void);
+size_t alloc_peak(void);
+void   alloc_reset_peak(void);  /* peak := current */
@@ -0,0 +1,285 @@
+#include "bench.h"
+#include "decompile/config.h"
+
+#include <chrono>
+#include <random>
+
+// End-to-end decompiler benchmarks with a per-phase breakdown
+//
+// The corpus is generated: one near function per size, built from a mix of
+// the shapes real compiler output is full of (frame setup, locals, params,
+// globals, compare-and-branch, counted loops, calls with pushed arguments
+// and caller cleanup) against a config that knows the globals and half of
+// the call targets. Every function must fit in a 64K segment, which caps it
+// at roughly 20k instructions with this mix.
+//
+// dis86_decompile reports its phases through the phase observer; each one is
+// timed and its heap high-water mark (above what was live when it started)
+// recorded. Decoding happens outside dis86_decompile and is measured here as
+// its own phase. Times are averaged over as many runs as fit in --min-time.
+
+#define CODE_LIMIT   0xe000  /* keep clear of the call target pool */
+#define CALL_TARGETS 64
+#define CALL_BASE    0xf000
+#define N_GLOBALS    512
+#define GLOBAL_BASE  0x1000
+
+typedef struct corpus_func corpus_func_t;
+struct corpus_func
+{
+  size_t               n_ins;
+  std::vector<uint8_t> bytes;
+};
+
+typedef struct gen gen_t;
+struct gen
+{
+  std::mt19937         rng;
+  std::vector<uint8_t> out;
+  std::vector<size_t>  starts;  /* instruction boundaries, for branches */
+};
+
+static void put(gen_t *g, std::initializer_list<uint8_t> bytes)
+{
+  g->starts.push_back(g->out.size());
+  g->out.insert(g->out.end(), bytes);
+}
+
+static uint8_t rnd(gen_t *g, uint32_t n) { return (uint8_t)(g->rng() % n); }
+
+static int8_t local_disp(gen_t *g) { return (int8_t)(-2 - 2*rnd(g, 32)); }
+static int8_t param_disp(gen_t *g) { return (int8_t)(4 + 2*rnd(g, 8)); }
+
+static void gen_simple(gen_t *g)
+{
+  uint16_t glob = GLOBAL_BASE + 2*rnd(g, N_GLOBALS/2) + 256*2*rnd(g, 2);
+  switch (rnd(g, 12)) {
+    case 0:  put(g, {0x8b, 0x46, (uint8_t)local_disp(g)}); break;                // mov ax,[bp-x]
+    case 1:  put(g, {0x89, 0x46, (uint8_t)local_disp(g)}); break;                // mov [bp-x],ax
+    case 2:  put(g, {0x8b, 0x5e, (uint8_t)param_disp(g)}); break;                // mov bx,[bp+x]
+    case 3:  put(g, {0x8b, 0x06, (uint8_t)glob, (uint8_t)(glob >> 8)}); break;   // mov ax,[glob]
+    case 4:  put(g, {0x89, 0x06, (uint8_t)glob, (uint8_t)(glob >> 8)}); break;   // mov [glob],ax
+    case 5:  put(g, {0x01, 0xd8}); break;                                        // add ax,bx
+    case 6:  put(g, {0x29, 0xc8}); break;                                        // sub ax,cx
+    case 7:  put(g, {0x31, 0xc0}); break;                                        // xor ax,ax
+    case 8:  put(g, {0x89, 0xc3}); break;                                        // mov bx,ax
+    case 9:  put(g, {0x41}); break;                                              // inc cx
+    case 10: put(g, {0x83, 0x46, (uint8_t)local_disp(g), rnd(g, 16)}); break;    // add word [bp-x],imm8
+    default: put(g, {0xd1, 0xe0}); break;                                        // shl ax,1
+  }
+}
+
+static void gen_call(gen_t *g)
+{
+  // push two args, call, add sp,4
+  put(g, {0x50});
+  put(g, {0xff, 0x76, (uint8_t)param_disp(g)});
+  uint16_t target = CALL_BASE + 16*rnd(g, CALL_TARGETS);
+  uint16_t rel = (uint16_t)(target - (g->out.size() + 3));
+  put(g, {0xe8, (uint8_t)rel, (uint8_t)(rel >> 8)});
+  put(g, {0x83, 0xc4, 0x04});
+}
+
+static void gen_if(gen_t *g)
+{
+  // cmp ax,imm16 ; jcc over a short block
+  put(g, {0x3d, rnd(g, 255), rnd(g, 255)});
+  size_t jcc = g->out.size();
+  put(g, {(uint8_t)(0x72 + 2*rnd(g, 6)), 0});
+  size_t n = 1 + rnd(g, 4);
+  for (size_t i = 0; i < n; i++) gen_simple(g);
+  g->out[jcc+1] = (uint8_t)(g->out.size() - (jcc + 2));
+}
+
+static void gen_loop(gen_t *g)
+{
+  // a block, dec cx, jnz back to its start
+  size_t top = g->out.size();
+  size_t n = 1 + rnd(g, 6);
+  for (size_t i = 0; i < n; i++) gen_simple(g);
+  put(g, {0x49});
+  put(g, {0x75, 0});
+  g->out.back() = (uint8_t)(int8_t)(top - g->out.size());
+}
+
+static corpus_func_t gen_function(uint32_t seed, size_t target_ins)
+{
+  gen_t g;
+  g.rng.seed(seed);
+
+  put(&g, {0x55});              // push bp
+  put(&g, {0x89, 0xe5});        // mov bp,sp
+  put(&g, {0x83, 0xec, 0x40});  // sub sp,0x40
+
+  while (g.starts.size() + 3 < target_ins && g.out.size() + 32 < CODE_LIMIT) {
+    switch (rnd(&g, 10)) {
+      case 0:  gen_call(&g); break;
+      case 1:
+      case 2:  gen_if(&g);   break;
+      case 3:  gen_loop(&g); break;
+      default: gen_simple(&g); break;
+    }
+  }
+
+  put(&g, {0x89, 0xec});        // mov sp,bp
+  put(&g, {0x5d});              // pop bp
+  put(&g, {0xc3});              // ret
+
+  corpus_func_t f;
+  f.n_ins = g.starts.size();
+  f.bytes = std::move(g.out);
+  return f;
+}
+
+static dis86_decompile_config_t * gen_config(void)
+{
+  dis86_decompile_config_t *cfg = dis86_decompile_config_default_new();
+
+  for (size_t i = 0; i < N_GLOBALS; i++) {
+    config_global_t *g = &cfg->global_arr[cfg->global_len++];
+    char name[32];
+    sprintf(name, "g_%04zx", GLOBAL_BASE + 2*i);
+    g->name   = strdup(name);
+    g->offset = (uint16_t)(GLOBAL_BASE + 2*i);
+    g->type   = strdup("u16");
+  }
+  config_globals_changed(cfg);
+
+  for (size_t i = 0; i < CALL_TARGETS; i += 2) {
+    config_func_t *f = &cfg->func_arr[cfg->func_len++];
+    char name[32];
+    sprintf(name, "F_%04zx", CALL_BASE + 16*i);
+    f->name = strdup(name);
+    f->addr = segoff_t{0, (uint16_t)(CALL_BASE + 16*i)};
+    f->ret  = strdup("u16");
+    f->args = 2;
+    f->pop_args_after_call = true;
+  }
+
+  return cfg;
+}
+
+/*****************************************************************/
+/* PHASE ACCOUNTING */
+/*****************************************************************/
+
+typedef struct phase_stat phase_stat_t;
+struct phase_stat
+{
+  const char * name;
+  double       secs;
+  size_t       peak;   /* max over runs of the high-water mark above the start */
+};
+
+typedef struct profile profile_t;
+struct profile
+{
+  std::vector<phase_stat_t>             phases;  /* in first-seen order */
+  std::chrono::steady_clock::time_point t0;
+  size_t                                base;
+  size_t                                hw;      /* absolute heap high-water mark of this run */
+};
+
+static phase_stat_t * profile_phase(profile_t *p, const char *name)
+{
+  for (phase_stat_t& s : p->phases) {
+    if (0 == strcmp(s.name, name)) return &s;
+  }
+  p->phases.push_back(phase_stat_t{name, 0, 0});
+  return &p->phases.back();
+}
+
+static void profile_begin(profile_t *p)
+{
+  // Phases reset the peak, so fold it into the run's mark first
+  if (alloc_peak() > p->hw) p->hw = alloc_peak();
+  p->base = alloc_current();
+  alloc_reset_peak();
+  p->t0 = std::chrono::steady_clock::now();
+}
+
+static void profile_end(profile_t *p, const char *name)
+{
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - p->t0).count();
+  phase_stat_t *s = profile_phase(p, name);
+  s->secs += secs;
+  size_t peak = alloc_peak() - p->base;
+  if (peak > s->peak) s->peak = peak;
+  if (alloc_peak() > p->hw) p->hw = alloc_peak();
+}
+
+static void on_phase(void *user, const char *phase, bool end)
+{
+  profile_t *p = (profile_t*)user;
+  if (end) profile_end(p, phase);
+  else     profile_begin(p);
+}
+
+/*****************************************************************/
+/* DRIVER */
+/*****************************************************************/
+
+static void run_once(profile_t *p, const corpus_func_t *f)
+{
+  dis86_decompile_config_t *cfg = gen_config();
+
+  auto t0 = std::chrono::steady_clock::now();
+  size_t base = alloc_current();
+  p->hw = base;
+
+  profile_begin(p);
+  dis86_t *d = dis86_new_view(0, segment<uint8_t>((uint8_t*)f->bytes.data(), f->bytes.size()), nullptr);
+  std::vector<dis86_instr_t> ins;
+  while (dis86_instr_t *i = dis86_next(d)) ins.push_back(*i);
+  profile_end(p, "decode");
+
+  dis86_decompile_set_phase_observer(on_phase, p);
+  std::string s = dis86_decompile(d, cfg, "bench_func", 0, ins.data(), ins.size());
+  dis86_decompile_set_phase_observer(nullptr, nullptr);
+
+  dis86_delete(d);
+  dis86_decompile_config_delete(cfg);
+
+  if (alloc_peak() > p->hw) p->hw = alloc_peak();
+  phase_stat_t *tot = profile_phase(p, "total");
+  tot->secs += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  if (p->hw - base > tot->peak) tot->peak = p->hw - base;
+}
+
+std::vector<result_t> bench_decompile(const char *filter, uint32_t seed)
+{
+  static const size_t sizes[] = {10, 100, 1000, 5000, 10000, 20000};
+
+  std::vector<result_t> results;
+  for (size_t size : sizes) {
+    char prefix[64];
+    sprintf(prefix, "decompile/%zu/", size);
+    // Don't bother generating and running sizes the filter rules out
+    if (filter && strstr(filter, "decompile/") && !strstr(prefix, filter) && !strstr(filter, prefix)) continue;
+
+    corpus_func_t f = gen_function(seed + (uint32_t)size, size);
+    if (f.n_ins < size) {
+      fprintf(stderr, "INFO: %s capped at %zu instructions by the 64K segment\n", prefix, f.n_ins);
+    }
+
+    profile_t p = {};
+    uint64_t runs = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    do {
+      run_once(&p, &f);
+      runs++;
+    } while (std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() < g_min_time);
+
+    for (const phase_stat_t& s : p.phases) {
+      result_t r;
+      r.name = std::string(prefix) + s.name;
+      if (filter && r.name.find(filter) == std::string::npos) continue;
+      r.iterations    = runs;
+      r.ns_per_item   = s.secs * 1e9 / (double)runs;
+      r.items_per_sec = (double)runs / s.secs;
+      r.peak_bytes    = alloc_tracking() ? (int64_t)s.peak : -1;
+      results.push_back(r);
+    }
+  }
+  return results;
+}
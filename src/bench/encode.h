@@ -0,0 +1,77 @@
+#pragma once
+#include "dis86.h"
+#include "instr.h"
+
+#include <vector>
+
+// Valid encodings drawn from the instruction table, shared by the benchmark
+// streams and the decode fuzzer. The caller supplies the choices as bytes
+// (from an RNG, or straight from fuzzer input) and the helpers bend them into
+// something the decoder accepts: no invalid opcodes, a register field that
+// names a segment register where one is required, and a memory mode for
+// memory-only operands.
+
+static bool fmt_has_operand(const instr_fmt_t *fmt, std::initializer_list<operand_e> kinds)
+{
+  for (operand_e o : fmt->operands) {
+    for (operand_e k : kinds) {
+      if (o == k) return true;
+    }
+  }
+  return false;
+}
+
+static bool fmt_needs_modrm(const instr_fmt_t *fmt)
+{
+  return fmt->opcode2 != 0xff || fmt_has_operand(fmt, {
+      operand_e::R8, operand_e::R16, operand_e::SREG,
+      operand_e::M8, operand_e::M16, operand_e::M32,
+      operand_e::RM8, operand_e::RM16 });
+}
+
+static bool is_prefix(uint8_t b)
+{
+  return b == 0x26 || b == 0x2e || b == 0x36 || b == 0x3e || b == 0xf2 || b == 0xf3;
+}
+
+static std::vector<const instr_fmt_t*> valid_fmts(bool modrm_only)
+{
+  std::vector<const instr_fmt_t*> fmts;
+  for (const instr_fmt_t& fmt : instr_tbl) {
+    if (fmt.op == operation_e::INVAL || is_prefix(fmt.opcode1)) continue;
+    if (modrm_only && !fmt_needs_modrm(&fmt)) continue;
+    fmts.push_back(&fmt);
+  }
+  return fmts;
+}
+
+#define ENCODE_MAX 32  /* comfortably more than prefixes + the longest instruction */
+
+// Fills buf[0..ENCODE_MAX) with the prefixes, opcode and modrm of one
+// instruction built from 'fmt' (choices from next()) followed by bytes from
+// fill(), of which the decoder takes what it needs for displacements and
+// immediates. Returns the instruction's length as decided by the decoder.
+template<class NEXT, class FILL>
+static size_t encode_instr(uint8_t buf[ENCODE_MAX], const instr_fmt_t *fmt, size_t n_prefix,
+                           bool force_disp, NEXT next, FILL fill)
+{
+  static const uint8_t prefixes[] = {0x26, 0x2e, 0x36, 0x3e, 0xf2, 0xf3};
+
+  size_t n = 0;
+  for (size_t i = 0; i < n_prefix; i++) buf[n++] = prefixes[next() % ARRAY_SIZE(prefixes)];
+  buf[n++] = fmt->opcode1;
+
+  if (fmt_needs_modrm(fmt)) {
+    bool mem_only = fmt_has_operand(fmt, {operand_e::M8, operand_e::M16, operand_e::M32});
+    uint8_t mod = force_disp ? 1 + next() % 2 : next() % (mem_only ? 3 : 4);
+    uint8_t reg = fmt->opcode2 != 0xff ? fmt->opcode2 : next() % 8;
+    if (fmt_has_operand(fmt, {operand_e::SREG})) reg %= 4;
+    buf[n++] = (uint8_t)(mod << 6 | reg << 3 | (next() % 8));
+  }
+  while (n < ENCODE_MAX) buf[n++] = (uint8_t)fill();
+
+  dis86_t *d = dis86_new_view(0, segment<uint8_t>(buf, ENCODE_MAX), nullptr);
+  size_t len = dis86_next(d)->n_bytes;
+  dis86_delete(d);
+  return len;
+}
@@ -1,20 +1,40 @@
 #include "header.h"
 
 #include "common/dynarray.h"
+#include "common/segment.h"
+#include "platform/dos.h"
 
 struct binary_t
 {
-  dynarray mem;
+  dynarray owned;       // backing store when the instance made its own copy
+  segment<uint8_t> mem; // the region being decoded (may be a view into someone else's memory)
   size_t idx;
   size_t base_addr;
+  const dos::relocation_index_t * relocs; // optional
 };
 
 static inline void binary_init(binary_t *b, size_t base_addr, segment<uint8_t> mem)
 {
-  b->mem.init(mem.size());
-  memcpy(b->mem.data(), mem.data(), b->mem.size());
+  b->owned.init(mem.size());
+  memcpy(b->owned.data(), mem.data(), b->owned.size());
+  b->mem = b->owned.segment(0, b->owned.size());
   b->idx = base_addr;
   b->base_addr = base_addr;
+  b->relocs = nullptr;
+}
+
+static inline void binary_init_view(binary_t *b, size_t base_addr, segment<uint8_t> mem,
+                                    const dos::relocation_index_t *relocs)
+{
+  b->mem = mem;
+  b->idx = base_addr;
+  b->base_addr = base_addr;
+  b->relocs = relocs;
+}
+
+static inline void binary_fini(binary_t *b)
+{
+  b->owned.clear();
 }
 
 static inline uint8_t binary_byte_at(binary_t *b, size_t idx)
@@ -26,6 +46,11 @@ static inline uint8_t binary_byte_at(binary_t *b, size_t idx)
   return b->mem[idx - b->base_addr];
 }
 
+static inline bool binary_is_reloc(binary_t *b, size_t idx)
+{
+  return b->relocs && b->relocs->contains((uint32_t)idx);
+}
+
 static inline uint8_t binary_peek_uint8_t(binary_t *b)
 {
   uint8_t byte = binary_byte_at(b, b->idx);
@@ -6,8 +6,13 @@
 
 #define HAX_FAIL(...) do { fprintf(stderr, "FAIL (%s:%d): ", __FUNCTION__, __LINE__); fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n"); abort(); } while(0)
 
+// Syntax errors unwind to parse_new, which frees the partial tree and reports parse_error
+#define PARSE_FAIL(...) do { fprintf(stderr, "bsl: "); fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n"); throw parse_fail{}; } while(0)
+
 namespace bsl
 {
+  struct parse_fail {};
+
   enum class token_e : uint8_t
   {
     invalid = 254,
@@ -88,7 +93,7 @@ namespace bsl
         parser_advance(p);
         c = parser_char(p);
         if (c == '\0')
-          HAX_FAIL("REACHED EOF WHILE INSIDE A QUOTED STRING");
+          PARSE_FAIL("REACHED EOF WHILE INSIDE A QUOTED STRING");
         if (c == '"') break; // Found!!
       }
 
@@ -112,7 +117,7 @@ namespace bsl
       return;
     }
 
-    HAX_FAIL("BAD TOK");
+    PARSE_FAIL("BAD TOK");
   }
 
   static char* parser_tok_str(parser_t *p)
@@ -136,7 +141,7 @@ namespace bsl
     n->toplevel = 0;
 
     if (!n->kv_arr) {
-      free_node(n);
+      ::free(n);
       return nullptr;
     }
 
@@ -147,6 +152,7 @@ namespace bsl
   {
     for (size_t i = 0; i < n->kv_len; i++) {
       keyval_t *kv = &n->kv_arr[i];
+      ::free(kv->key);
       if (kv->type == node_e::string) {
         ::free(kv->val.string);
       } else if (kv->type == node_e::node) {
@@ -154,7 +160,7 @@ namespace bsl
       }
     }
     ::free(n->kv_arr);
-    free_node(n);
+    ::free(n);
   }
 
   static void node_append(node_t *n, keyval_t kv /* value moved into this node */)
@@ -186,15 +192,17 @@ namespace bsl
     else if (p->tok_type == token_e::open) {
       parser_tok_next(p);
       rval.node = parse_node(p);
-      if (p->tok_type != token_e::close)
-        HAX_FAIL("Expected closing '}'");
+      if (p->tok_type != token_e::close) {
+        node_delete(rval.node);
+        PARSE_FAIL("Expected closing '}'");
+      }
       parser_tok_next(p);
       out_type = node_e::node;
       return rval;
     }
 
     else {
-      HAX_FAIL("Expected value to start with either a string or '{', got [0x%x]", int(p->tok_type));
+      PARSE_FAIL("Expected value to start with either a string or '{', got [0x%x]", int(p->tok_type));
     }
 
   }
@@ -207,7 +215,13 @@ namespace bsl
     parser_tok_next(p);
 
     node_e type;
-    node_val_t val = parse_value(p, type);
+    node_val_t val;
+    try {
+      val = parse_value(p, type);
+    } catch (...) {
+      ::free(key);
+      throw;
+    }
 
     out_kv.type = type;
     out_kv.key  = key;
@@ -221,10 +235,15 @@ namespace bsl
   {
     node_t * node = node_new();
 
-    while (1) {
-      keyval_t kv;
-      if (!parse_keyval(p, kv)) break;
-      node_append(node, kv);
+    try {
+      while (1) {
+        keyval_t kv;
+        if (!parse_keyval(p, kv)) break;
+        node_append(node, kv);
+      }
+    } catch (...) {
+      node_delete(node);
+      throw;
     }
 
     return node;
@@ -234,11 +253,19 @@ namespace bsl
   {
     parser_t p[1];
     parser_init(p, buf);
-    parser_tok_next(p);
 
-    node_t * node = parse_node(p);
-    if (p->tok_type != token_e::eof)
-      HAX_FAIL("EXPECTED EOF");
+    node_t * node = nullptr;
+    try {
+      parser_tok_next(p);
+      node = parse_node(p);
+      if (p->tok_type != token_e::eof)
+        PARSE_FAIL("EXPECTED EOF");
+    } catch (const parse_fail&) {
+      if (node) node_delete(node);
+      if (opt_err)
+        *opt_err = error_e::parse_error;
+      return nullptr;
+    }
 
     if (opt_err)
       *opt_err = error_e::success;
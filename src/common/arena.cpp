@@ -0,0 +1,88 @@
+#include "arena.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+typedef struct arena_chunk arena_chunk_t;
+struct arena_chunk
+{
+  arena_chunk_t * next;
+  size_t          size;
+  alignas(std::max_align_t) uint8_t data[];
+};
+
+struct arena
+{
+  size_t          chunk_size;
+  arena_chunk_t * head;
+  arena_chunk_t * cur;
+  size_t          off;   /* into cur->data */
+  size_t          used;
+};
+
+arena_t * arena_new(size_t chunk_size)
+{
+  arena_t *a = (arena_t*)calloc(1, sizeof(arena_t));
+  a->chunk_size = chunk_size;
+  return a;
+}
+
+void arena_delete(arena_t *a)
+{
+  if (!a) return;
+  arena_chunk_t *c = a->head;
+  while (c) {
+    arena_chunk_t *next = c->next;
+    free(c);
+    c = next;
+  }
+  free(a);
+}
+
+void arena_reset(arena_t *a)
+{
+  a->cur  = a->head;
+  a->off  = 0;
+  a->used = 0;
+}
+
+static size_t align_up(size_t n, size_t align)
+{
+  return (n + align - 1) & ~(align - 1);
+}
+
+void * arena_alloc(arena_t *a, size_t size, size_t align)
+{
+  if (a->cur) {
+    size_t off = align_up(a->off, align);
+    if (off + size <= a->cur->size) {
+      a->off = off + size;
+      a->used += size;
+      return a->cur->data + off;
+    }
+  }
+
+  // Move on to the first chunk kept from an earlier round that is big
+  // enough, or append a new one. Chunks skipped over sit idle until the
+  // next reset.
+  arena_chunk_t **link = a->cur ? &a->cur->next : &a->head;
+  while (*link && (*link)->size < size) link = &(*link)->next;
+  if (!*link) {
+    size_t n = size > a->chunk_size ? align_up(size, 4096) : a->chunk_size;
+    arena_chunk_t *c = (arena_chunk_t*)malloc(sizeof(arena_chunk_t) + n);
+    if (!c) abort();
+    c->next = nullptr;
+    c->size = n;
+    *link = c;
+  }
+
+  a->cur  = *link;
+  a->off  = size;
+  a->used += size;
+  return a->cur->data;
+}
+
+size_t arena_used(arena_t *a)
+{
+  return a->used;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory_resource>
+
+// Bump allocator for state that lives and dies together (everything one
+// function decompile builds). Nothing is freed individually: arena_reset()
+// drops it all at once and keeps the chunks, so the next user starts on
+// memory that is already mapped and warm.
+
+typedef struct arena arena_t;
+
+arena_t * arena_new(size_t chunk_size);
+void      arena_delete(arena_t *a);
+void      arena_reset(arena_t *a);
+
+void *    arena_alloc(arena_t *a, size_t size, size_t align);  /* uninitialized */
+size_t    arena_used(arena_t *a);  /* bytes handed out since the last reset */
+
+/* Zeroed room for n T's (at least one, like the calloc calls it replaces) */
+template<typename T>
+static inline T * arena_calloc(arena_t *a, size_t n)
+{
+  size_t size = (n ? n : 1) * sizeof(T);
+  return (T*)memset(arena_alloc(a, size, alignof(T)), 0, size);
+}
+
+// The arena as an allocator for std::pmr containers. Deallocation is a no-op
+// until the arena is reset, so containers must not outlive that.
+struct arena_resource : std::pmr::memory_resource
+{
+  arena_t *arena;
+  explicit arena_resource(arena_t *a) : arena(a) {}
+
+private:
+  void * do_allocate(size_t size, size_t align) override { return arena_alloc(arena, size, align); }
+  void   do_deallocate(void *, size_t, size_t) override {}
+  bool   do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
@@ -0,0 +1,32 @@
+#include "header.h"
+#include "fail.h"
+
+#include <cstdarg>
+
+static thread_local int recover_depth = 0;
+
+fail_recover::fail_recover()  { recover_depth++; }
+fail_recover::~fail_recover() { recover_depth--; }
+
+void fail(const char *fmt, ...)
+{
+  va_list ap;
+  va_start(ap, fmt);
+
+  if (recover_depth > 0) {
+    fail_error err;
+    vsnprintf(err.msg, sizeof(err.msg), fmt, ap);
+    va_end(ap);
+
+    // Some messages carry their own newline
+    size_t len = strlen(err.msg);
+    if (len && err.msg[len-1] == '\n') err.msg[len-1] = 0;
+    throw err;
+  }
+
+  fprintf(stderr, "FAIL: ");
+  vfprintf(stderr, fmt, ap);
+  fprintf(stderr, "\n");
+  va_end(ap);
+  exit(42);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <exception>
+
+// FAIL() reports the problem and exits, which is what the command line
+// tools want. Library entry points that promise to return errors instead
+// open a fail_recover scope: while one is open on the thread, FAIL() throws
+// fail_error, and the entry point catches it, cleans up and hands the
+// message back as a status.
+
+struct fail_error : std::exception
+{
+  char msg[256];
+  const char *what() const noexcept override { return msg; }
+};
+
+struct fail_recover
+{
+  fail_recover();
+  ~fail_recover();
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <unistd.h>
+
+// 64-bit FNV-1a. Not cryptographic: meant for cache keys and content
+// addressing, where inputs are ours. Whether a collision is caught is up to
+// the user: the memo compares its full key on a hit, but the db takes a key
+// at its word and would hand back the other input's record.
+
+#define HASH_INIT UINT64_C(0xcbf29ce484222325)
+
+static inline uint64_t hash_bytes(uint64_t h, const void *data, size_t len)
+{
+  const uint8_t *p = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < len; i++) {
+    h ^= p[i];
+    h *= UINT64_C(0x100000001b3);
+  }
+  return h;
+}
+
+static inline uint64_t hash_u64(uint64_t h, uint64_t v)
+{
+  uint8_t buf[8];
+  for (size_t i = 0; i < 8; i++) buf[i] = (uint8_t)(v >> (8*i));
+  return hash_bytes(h, buf, sizeof(buf));
+}
+
+// Includes the terminator so that ("ab","c") and ("a","bc") differ
+static inline uint64_t hash_str(uint64_t h, const char *s)
+{
+  if (!s) return hash_u64(h, 0);
+  size_t len = 0;
+  while (s[len]) len++;
+  return hash_bytes(h, s, len+1);
+}
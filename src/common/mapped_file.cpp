@@ -0,0 +1,39 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+bool mapped_file::open(const std::string& filename)
+{
+  assert(empty());
+
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    ::close(fd);
+    return false;
+  }
+
+  void *mem = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  ::close(fd); // the mapping keeps its own reference
+  if (mem == MAP_FAILED)
+    return false;
+
+  m_data = static_cast<uint8_t*>(mem);
+  m_size = st.st_size;
+  return true;
+}
+
+void mapped_file::close(void)
+{
+  if(!empty())
+  {
+    munmap(m_data, m_size);
+    m_data = nullptr;
+    m_size = 0;
+  }
+}
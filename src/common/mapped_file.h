@@ -0,0 +1,47 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <unistd.h>
+#include <cassert>
+
+#include "segment.h"
+
+// Read-only view of a whole file. The mapping is private (copy-on-write), so
+// the segments handed out may be written to without touching the file.
+class mapped_file
+{
+public:
+  mapped_file(void) = default;
+  ~mapped_file(void) { close(); }
+
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator =(const mapped_file&) = delete;
+
+  bool open(const std::string& filename);
+  void close(void);
+
+  constexpr size_t   size (void) const { return m_size; }
+  template<typename T = uint8_t> constexpr T* data (void) const { return reinterpret_cast<T*>(m_data); }
+  template<typename T = uint8_t> constexpr T* dataAtOffset (size_t offset) const
+  {
+    assert(offset < m_size);
+    return reinterpret_cast<T*>(m_data + offset);
+  }
+
+  template<typename T = uint8_t>
+  segment<T> segment(size_t offset, size_t length) const
+  {
+    assert(offset + length * sizeof(T) <= m_size);
+    return ::segment<T>(m_data + offset, length);
+  }
+
+  constexpr bool     empty(void) const { return m_data == nullptr; }
+  constexpr operator bool(void) const { return !empty(); }
+private:
+  size_t m_size = 0;
+  uint8_t* m_data = nullptr;
+};
+
+#endif // MAPPED_FILE_H
@@ -31,6 +31,12 @@ class segment
     constexpr T* data(void) const { return m_data; }
     constexpr size_t size(void) const { return m_size;}
     constexpr void* after(void) const { return reinterpret_cast<void*>(data() + size()); }
+
+    segment<T> slice(size_t offset, size_t length) const
+    {
+      assert(offset + length <= size());
+      return segment<T>(m_data + offset, length);
+    }
   private:
     T* m_data = nullptr;
     size_t m_size = 0;
@@ -0,0 +1,137 @@
+#include "stats.h"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const char *counter_names[] = {
+#define X(id, name) name,
+  STATS_COUNTERS(X)
+#undef X
+};
+static_assert(sizeof(counter_names)/sizeof(counter_names[0]) == STAT_COUNTERS_N, "");
+
+#if DIS86_STATS
+
+#define SLOWEST_FUNCS 10
+
+typedef struct stats_timer stats_timer_t;
+struct stats_timer
+{
+  const char * name;
+  uint64_t     count;
+  uint64_t     ns;
+};
+
+typedef struct stats_func stats_func_t;
+struct stats_func
+{
+  std::string name;
+  size_t      n_ins;
+  uint64_t    ns;
+};
+
+uint64_t stats_counter[STAT_COUNTERS_N];
+
+static std::vector<stats_timer_t> timers;  /* in first-use order; a dozen or so entries */
+static std::vector<stats_func_t>  slowest; /* descending by ns */
+
+uint64_t stats_now_ns(void)
+{
+  auto t = std::chrono::steady_clock::now().time_since_epoch();
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+}
+
+void stats_timer_add(const char *name, uint64_t ns)
+{
+  stats_timer_t *t = nullptr;
+  for (stats_timer_t& cand : timers) {
+    // Names are almost always the same literal, so try the pointer first
+    if (cand.name == name || 0 == strcmp(cand.name, name)) { t = &cand; break; }
+  }
+  if (!t) {
+    timers.push_back(stats_timer_t{name, 0, 0});
+    t = &timers.back();
+  }
+  t->count++;
+  t->ns += ns;
+}
+
+void stats_function(const char *name, size_t n_ins, uint64_t ns)
+{
+  if (slowest.size() == SLOWEST_FUNCS && ns <= slowest.back().ns) return;
+
+  size_t i = slowest.size();
+  while (i > 0 && slowest[i-1].ns < ns) i--;
+  slowest.insert(slowest.begin() + i, stats_func_t{name ? name : "", n_ins, ns});
+  if (slowest.size() > SLOWEST_FUNCS) slowest.pop_back();
+}
+
+void stats_reset(void)
+{
+  memset(stats_counter, 0, sizeof(stats_counter));
+  timers.clear();
+  slowest.clear();
+}
+
+static void print_json_str(FILE *f, const char *s)
+{
+  fputc('"', f);
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\') fprintf(f, "\\%c", *s);
+    else if ((unsigned char)*s < 0x20) fprintf(f, "\\u%04x", *s);
+    else fputc(*s, f);
+  }
+  fputc('"', f);
+}
+
+void stats_print(FILE *f, bool json)
+{
+  if (json) {
+    fprintf(f, "{\n  \"counters\": {\n");
+    for (size_t i = 0; i < STAT_COUNTERS_N; i++) {
+      fprintf(f, "    \"%s\": %llu%s\n", counter_names[i], (unsigned long long)stats_counter[i],
+              i+1 < STAT_COUNTERS_N ? "," : "");
+    }
+    fprintf(f, "  },\n  \"timers\": {\n");
+    for (size_t i = 0; i < timers.size(); i++) {
+      fprintf(f, "    \"%s\": { \"count\": %llu, \"ms\": %.3f }%s\n", timers[i].name,
+              (unsigned long long)timers[i].count, timers[i].ns / 1e6, i+1 < timers.size() ? "," : "");
+    }
+    fprintf(f, "  },\n  \"slowest_functions\": [\n");
+    for (size_t i = 0; i < slowest.size(); i++) {
+      fprintf(f, "    { \"name\": ");
+      print_json_str(f, slowest[i].name.c_str());
+      fprintf(f, ", \"instrs\": %zu, \"ms\": %.3f }%s\n", slowest[i].n_ins, slowest[i].ns / 1e6,
+              i+1 < slowest.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    return;
+  }
+
+  fprintf(f, "STATS:\n");
+  for (size_t i = 0; i < STAT_COUNTERS_N; i++) {
+    if (!stats_counter[i]) continue;
+    fprintf(f, "  %-30s %12llu\n", counter_names[i], (unsigned long long)stats_counter[i]);
+  }
+  for (const stats_timer_t& t : timers) {
+    fprintf(f, "  %-30s %12.3f ms  (%llu)\n", t.name, t.ns / 1e6, (unsigned long long)t.count);
+  }
+  for (const stats_func_t& fn : slowest) {
+    fprintf(f, "  slowest: %-30s %8zu instrs %12.3f ms\n", fn.name.c_str(), fn.n_ins, fn.ns / 1e6);
+  }
+}
+
+#else
+
+void stats_reset(void) {}
+
+void stats_print(FILE *f, bool json)
+{
+  (void)counter_names;
+  if (json) fprintf(f, "{ \"disabled\": true }\n");
+  else      fprintf(f, "STATS: disabled at build time (DIS86_STATS=0)\n");
+}
+
+#endif
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+// Always-on instrumentation: event counters and scoped wall-clock timers,
+// reported by the front-ends with --stats. Build with -DDIS86_STATS=0 to
+// compile every STAT_* site away (the report then says so).
+//
+// Not thread-safe: the library decodes and decompiles on one thread.
+
+#ifndef DIS86_STATS
+#define DIS86_STATS 1
+#endif
+
+#define STATS_COUNTERS(X)                                                         \
+  X(DECODE_INSTRS,          "decode.instrs")            /* instructions decoded */ \
+  X(DECODE_BYTES,           "decode.bytes")                                        \
+  X(LABELS_FOUND,           "labels.found")                                        \
+  X(SYMBOLS_MERGED,         "symbols.merged")           /* overlaps folded in symtab_add_merge */ \
+  X(SYMBOLS_LOOKUP_MISS,    "symbols.lookup_miss")                                 \
+  X(CONFIG_FUNC_LOOKUP,     "config.func_lookup")                                  \
+  X(CONFIG_FUNC_LOOKUP_MISS,"config.func_lookup_miss")                             \
+  X(FUSED_XOR_RR,           "transform.xor_rr")         /* exprs rewritten/fused per pass */ \
+  X(FUSED_CMP_JMP,          "transform.cmp_jmp")                                   \
+  X(FUSED_OR_JMP,           "transform.or_jmp")                                    \
+  X(FUSED_CALLS,            "transform.synthesize_calls")                          \
+  X(FUSED_LONG_OPS,         "transform.long_ops")                                  \
+  X(FUSED_REP_STRING,       "transform.rep_string")                                \
+  X(FUSED_FLAGS,            "transform.fuse_flags")                                \
+  X(DROPPED_FLAGS,          "transform.lazy_flags")                                \
+  X(DROPPED_STORES,         "transform.dead_stores")                               \
+  X(MEMO_HIT,               "memo.hit")                                            \
+  X(MEMO_MISS,              "memo.miss")                                           \
+  X(DB_HIT,                 "db.hit")                                              \
+  X(DB_MISS,                "db.miss")                                             \
+  X(FUNCS_DECOMPILED,       "decompile.funcs")                                     \
+  X(EMIT_BYTES,             "emit.bytes")
+
+enum {
+#define X(id, name) STAT_##id,
+  STATS_COUNTERS(X)
+#undef X
+  STAT_COUNTERS_N,
+};
+
+/* Zero all counters, timers and the per-function record */
+void stats_reset(void);
+
+/* Write the report (to stderr in the front-ends; stdout carries the output) */
+void stats_print(FILE *f, bool json);
+
+#if DIS86_STATS
+
+extern uint64_t stats_counter[STAT_COUNTERS_N];
+
+void     stats_timer_add(const char *name, uint64_t ns);
+uint64_t stats_now_ns(void);
+
+/* Remember the cost of one function, so the report can name the slowest */
+void     stats_function(const char *name, size_t n_ins, uint64_t ns);
+
+// Adds the time until the end of the enclosing scope to the named timer
+struct stats_scope
+{
+  const char *name;
+  uint64_t    t0;
+  stats_scope(const char *name) : name(name), t0(stats_now_ns()) {}
+  ~stats_scope() { stats_timer_add(name, stats_now_ns() - t0); }
+};
+
+#define STAT_INC(id)    (stats_counter[STAT_##id]++)
+#define STAT_ADD(id, n) (stats_counter[STAT_##id] += (uint64_t)(n))
+#define STAT_TIMER(name) stats_scope _stats_timer(name)
+#define STAT_FUNCTION(name, n_ins, ns) stats_function(name, n_ins, ns)
+#define STAT_NOW()      stats_now_ns()
+
+#else
+
+#define STAT_INC(id)    ((void)0)
+#define STAT_ADD(id, n) ((void)0)
+#define STAT_TIMER(name) do {} while (0)
+#define STAT_FUNCTION(name, n_ins, ns) ((void)(ns))
+#define STAT_NOW()      ((uint64_t)0)
+
+#endif
@@ -0,0 +1,132 @@
+#include "db.h"
+#include "common/hash.h"
+#include "common/stats.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define DB_MAGIC UINT32_C(0x42443644) /* "D6DB" */
+
+struct db
+{
+  std::string dir;
+};
+
+struct db_record_header
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t length;
+  uint64_t hash;
+};
+
+static bool make_dir(const std::string& path)
+{
+  if (mkdir(path.c_str(), 0777) == 0) return true;
+  if (errno != EEXIST) return false;
+
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static std::string record_path(db_t *db, const char *table, uint64_t key)
+{
+  char name[17];
+  snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+  return db->dir + "/" + table + "/" + name;
+}
+
+static bool write_all(int fd, const void *data, size_t len)
+{
+  const uint8_t *p = static_cast<const uint8_t*>(data);
+  while (len) {
+    ssize_t n = ::write(fd, p, len);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p   += n;
+    len -= n;
+  }
+  return true;
+}
+
+static bool read_all(int fd, void *data, size_t len)
+{
+  uint8_t *p = static_cast<uint8_t*>(data);
+  while (len) {
+    ssize_t n = ::read(fd, p, len);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p   += n;
+    len -= n;
+  }
+  return true;
+}
+
+db_t * db_open(const char *dir)
+{
+  if (!make_dir(dir)) return nullptr;
+
+  db_t *db = new db_t;
+  db->dir = dir;
+  return db;
+}
+
+void db_close(db_t *db)
+{
+  delete db;
+}
+
+bool db_get(db_t *db, const char *table, uint64_t key, std::string *out)
+{
+  std::string path = record_path(db, table, key);
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) { STAT_INC(DB_MISS); return false; }
+
+  // The length on disk is checked against the file before anything is sized
+  // by it, so a damaged record can't ask for an arbitrary allocation
+  struct stat st;
+  db_record_header hdr;
+  bool ok = fstat(fd, &st) == 0 &&
+            read_all(fd, &hdr, sizeof(hdr)) &&
+            hdr.magic == DB_MAGIC &&
+            hdr.version == DB_FORMAT_VERSION &&
+            hdr.length == (uint64_t)st.st_size - sizeof(hdr);
+  if (ok) {
+    out->resize(hdr.length);
+    ok = read_all(fd, out->data(), hdr.length) &&
+         hash_bytes(HASH_INIT, out->data(), hdr.length) == hdr.hash;
+  }
+  ::close(fd);
+
+  if (!ok) out->clear();
+  if (ok) STAT_INC(DB_HIT);
+  else    STAT_INC(DB_MISS);
+  return ok;
+}
+
+bool db_put(db_t *db, const char *table, uint64_t key, const void *data, size_t len)
+{
+  if (!make_dir(db->dir + "/" + table)) return false;
+
+  std::string path = record_path(db, table, key);
+  std::string tmp  = path + ".tmp." + std::to_string(getpid());
+
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) return false;
+
+  db_record_header hdr;
+  hdr.magic   = DB_MAGIC;
+  hdr.version = DB_FORMAT_VERSION;
+  hdr.length  = len;
+  hdr.hash    = hash_bytes(HASH_INIT, data, len);
+
+  bool ok = write_all(fd, &hdr, sizeof(hdr)) && write_all(fd, data, len);
+  ok = (::close(fd) == 0) && ok;
+  if (ok) ok = rename(tmp.c_str(), path.c_str()) == 0;
+  if (!ok) unlink(tmp.c_str());
+  return ok;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <unistd.h>
+#include <string>
+
+// Project database: a directory of content-addressed records that lets
+// repeated runs skip work whose inputs haven't changed.
+//
+// Records live at <dir>/<table>/<key as 16 hex digits>. Each one starts with a
+// small header (magic, format version, payload length and hash) so that
+// truncated or stale files read back as misses rather than garbage. Writes
+// go to a temporary file that is renamed into place, so a crashed run never
+// leaves a half-written record behind. The key is all there is to a lookup:
+// two inputs hashing to the same key share a record.
+//
+// Bump DB_FORMAT_VERSION whenever the layout of a stored payload or the
+// decompiler's output for the same inputs changes.
+
+#define DB_FORMAT_VERSION 11
+
+typedef struct db db_t;
+
+db_t * db_open(const char *dir);   /* creates the directory; nullptr on failure */
+void   db_close(db_t *db);
+
+bool   db_get(db_t *db, const char *table, uint64_t key, std::string *out);
+bool   db_put(db_t *db, const char *table, uint64_t key, const void *data, size_t len);
@@ -1,10 +1,12 @@
 #include "dis86.h"
 #include "instr.h"
+#include "common/stats.h"
+#include "common/fail.h"
 
 // Register number to register enum
 static inline int reg8(uint8_t num)  { assert(num <= 7); return REG_AL + num; }
 static inline int reg16(uint8_t num) { assert(num <= 7); return REG_AX + num; }
-static inline int sreg16(uint8_t num) { assert(num <= 3); return REG_ES + num; }
+static inline int sreg16(uint8_t num) { if (num > 3) FAIL("Invalid segment register: %u", num); return REG_ES + num; }
 
 // Mode is the 2-bits from [6..7] in the ModRM byte
 static inline uint8_t modrm_mode(uint8_t modrm) { return modrm>>6; }
@@ -59,15 +61,25 @@ static inline operand_t operand_rel(binary_t *b, int sz)
   return o;
 }
 
+static inline operand_t operand_imm16_fetch(binary_t *b)
+{
+  bool reloc = binary_is_reloc(b, binary_location(b));
+  operand_t o = operand_imm16(binary_fetch_uint16_t(b));
+  o.u.imm.reloc = reloc;
+  return o;
+}
+
 static inline operand_t operand_far(binary_t *b)
 {
   uint16_t off = binary_fetch_uint16_t(b);
+  bool reloc = binary_is_reloc(b, binary_location(b));
   uint16_t seg = binary_fetch_uint16_t(b);
 
   operand_t o = {};
   o.type = OPERAND_TYPE_FAR;
   o.u.far.seg = seg;
   o.u.far.off = off;
+  o.u.far.reloc = reloc;
   return o;
 }
 
@@ -151,12 +163,12 @@ static inline operand_t operand_m32(binary_t *b, uint8_t modrm, int sreg)
   return o;
 }
 
-static inline operand_t operand_src(int sz)
+static inline operand_t operand_src(int sz, int sreg)
 {
   operand_t o = {};
   o.type = OPERAND_TYPE_MEM;
   o.u.mem.sz = sz;
-  o.u.mem.sreg = REG_DS; // TODO FIMXE: ARE SEG OVERRIDES ALLOWED FOR THESE??
+  o.u.mem.sreg = sreg ? sreg : REG_DS; // the source segment can be overridden
   o.u.mem.reg1 = REG_SI;
   o.u.mem.reg2 = REG_INVAL;
   o.u.mem.off  = 0;
@@ -168,7 +180,7 @@ static inline operand_t operand_dst(int sz)
   operand_t o = {};
   o.type = OPERAND_TYPE_MEM;
   o.u.mem.sz = sz;
-  o.u.mem.sreg = REG_ES; // TODO FIMXE: ARE SEG OVERRIDES ALLOWED FOR THESE??
+  o.u.mem.sreg = REG_ES; // but the destination is always ES
   o.u.mem.reg1 = REG_DI;
   o.u.mem.reg2 = REG_INVAL;
   o.u.mem.off  = 0;
@@ -282,8 +294,8 @@ dis86_instr_t *dis86_next(dis86_t *d)
       case operand_e::LIT3:  ins->operand[i] = operand_imm8(3); break;
 
       // Implied string operations operands
-      case operand_e::SRC8:  ins->operand[i] = operand_src(SIZE_8);  break;
-      case operand_e::SRC16: ins->operand[i] = operand_src(SIZE_16); break;
+      case operand_e::SRC8:  ins->operand[i] = operand_src(SIZE_8, sreg);  break;
+      case operand_e::SRC16: ins->operand[i] = operand_src(SIZE_16, sreg); break;
       case operand_e::DST8:  ins->operand[i] = operand_dst(SIZE_8);  break;
       case operand_e::DST16: ins->operand[i] = operand_dst(SIZE_16); break;
 
@@ -341,7 +353,7 @@ dis86_instr_t *dis86_next(dis86_t *d)
   // Process any immediate data
   if (oper_imm8)     *oper_imm8     = operand_imm8(binary_fetch_uint8_t(d->b));
   if (oper_imm8_ext) *oper_imm8_ext = operand_imm16((int8_t)binary_fetch_uint8_t(d->b));
-  if (oper_imm16)    *oper_imm16    = operand_imm16(binary_fetch_uint16_t(d->b));
+  if (oper_imm16)    *oper_imm16    = operand_imm16_fetch(d->b);
 
   // Process any memory offset immediates
   if (oper_moff8)  *oper_moff8  = operand_moff(d->b, SIZE_8, sreg);
@@ -358,5 +370,25 @@ dis86_instr_t *dis86_next(dis86_t *d)
   ins->n_bytes = binary_location(d->b) - start_loc;
   ins->intel_hidden = fmt->intel_hidden;
 
+  STAT_INC(DECODE_INSTRS);
+  STAT_ADD(DECODE_BYTES, ins->n_bytes);
   return ins;
 }
+
+dis86_status_t dis86_next_checked(dis86_t *d, dis86_instr_t **_ins, dis86_error_t *err)
+{
+  size_t start_loc = binary_location(d->b);
+  try {
+    fail_recover recover;
+    *_ins = dis86_next(d);
+    return *_ins ? DIS86_OK : DIS86_END;
+  } catch (const fail_error& e) {
+    d->b->idx = start_loc + 1;
+    *_ins = nullptr;
+    if (err) {
+      err->addr = start_loc;
+      snprintf(err->msg, sizeof(err->msg), "%s", e.msg);
+    }
+    return DIS86_ERROR;
+  }
+}
@@ -0,0 +1,199 @@
+#include "decompile_private.h"
+
+static uint32_t cfg_next_version = 1;
+
+cfg_flow_e cfg_instr_flow(dis86_instr_t *ins, size_t *target)
+{
+  operand_t *rel = nullptr;
+  cfg_flow_e flow;
+  switch (ins->opcode) {
+    case operation_e::JO:
+    case operation_e::JNO:
+    case operation_e::JB:
+    case operation_e::JAE:
+    case operation_e::JE:
+    case operation_e::JNE:
+    case operation_e::JBE:
+    case operation_e::JA:
+    case operation_e::JS:
+    case operation_e::JNS:
+    case operation_e::JP:
+    case operation_e::JNP:
+    case operation_e::JL:
+    case operation_e::JGE:
+    case operation_e::JLE:
+    case operation_e::JG:
+      flow = CFG_FLOW_COND;
+      rel = &ins->operand[0];
+      break;
+    case operation_e::LOOP:
+    case operation_e::LOOPE:
+    case operation_e::LOOPNE:
+    case operation_e::JCXZ:
+      flow = CFG_FLOW_COND;
+      rel = &ins->operand[1];
+      break;
+    case operation_e::JMP:
+      if (ins->operand[0].type != OPERAND_TYPE_REL) return CFG_FLOW_EXIT; // indirect
+      flow = CFG_FLOW_JUMP;
+      rel = &ins->operand[0];
+      break;
+    case operation_e::JMPF:
+    case operation_e::RET:
+    case operation_e::RETF:
+    case operation_e::IRET:
+    case operation_e::HLT:
+      return CFG_FLOW_EXIT;
+    default:
+      return CFG_FLOW_NEXT;
+  }
+
+  assert(rel->type == OPERAND_TYPE_REL);
+  *target = ins->addr + ins->n_bytes + (int16_t)rel->u.rel.val;
+  return flow;
+}
+
+static void cfg_release(cfg_t *cfg)
+{
+  free(cfg->blocks);
+  free(cfg->succ_off);
+  free(cfg->succ);
+  free(cfg->pred_off);
+  free(cfg->pred);
+  free(cfg->exits);
+  free(cfg->block_of);
+}
+
+cfg_t * cfg_new(dis86_instr_t *ins_arr, size_t n_ins)
+{
+  cfg_t *cfg = (cfg_t*)calloc(1, sizeof(cfg_t));
+  cfg_build(cfg, ins_arr, n_ins);
+  return cfg;
+}
+
+void cfg_delete(cfg_t *cfg)
+{
+  cfg_release(cfg);
+  free(cfg);
+}
+
+void cfg_build(cfg_t *cfg, dis86_instr_t *ins_arr, size_t n_ins)
+{
+  cfg_release(cfg);
+  memset(cfg, 0, sizeof(*cfg));
+
+  assert(n_ins < CFG_NONE);
+  cfg->n_ins    = (uint32_t)n_ins;
+  cfg->version  = cfg_next_version++;
+  cfg->succ_off = (uint32_t*)calloc(1, sizeof(uint32_t));
+  cfg->pred_off = (uint32_t*)calloc(1, sizeof(uint32_t));
+  if (n_ins == 0) return;
+
+  // Dense address -> instruction index map over the decoded range, so that
+  // resolving a branch target is a single lookup
+  size_t lo = ins_arr[0].addr;
+  size_t hi = ins_arr[n_ins-1].addr + ins_arr[n_ins-1].n_bytes;
+  uint32_t *index_at = (uint32_t*)malloc((hi - lo) * sizeof(uint32_t));
+  for (size_t a = 0; a < hi - lo; a++) index_at[a] = CFG_NONE;
+  for (size_t i = 0; i < n_ins; i++) {
+    assert(i == 0 || ins_arr[i].addr > ins_arr[i-1].addr);
+    index_at[ins_arr[i].addr - lo] = (uint32_t)i;
+  }
+
+  // Classify each instruction once and mark the block leaders: the entry,
+  // every branch target and whatever follows a branch
+  uint8_t  *flow   = (uint8_t*)malloc(n_ins);
+  uint32_t *target = (uint32_t*)malloc(n_ins * sizeof(uint32_t));
+  uint8_t  *leader = (uint8_t*)calloc(n_ins, 1);
+  leader[0] = 1;
+  for (size_t i = 0; i < n_ins; i++) {
+    size_t dst = 0;
+    flow[i]   = cfg_instr_flow(&ins_arr[i], &dst);
+    target[i] = CFG_NONE;
+    if (flow[i] == CFG_FLOW_NEXT) continue;
+
+    if (i+1 < n_ins) leader[i+1] = 1;
+    if (flow[i] == CFG_FLOW_EXIT) continue;
+    if (dst >= lo && dst < hi) target[i] = index_at[dst - lo]; // mid-instruction targets stay unresolved
+    if (target[i] != CFG_NONE) leader[target[i]] = 1;
+  }
+  free(index_at);
+
+  // Carve the blocks
+  uint32_t n_blocks = 0;
+  for (size_t i = 0; i < n_ins; i++) n_blocks += leader[i];
+
+  cfg->n_blocks = n_blocks;
+  cfg->blocks   = (cfg_block_t*)malloc(n_blocks * sizeof(cfg_block_t));
+  cfg->block_of = (uint32_t*)malloc(n_ins * sizeof(uint32_t));
+
+  uint32_t b = CFG_NONE;
+  for (size_t i = 0; i < n_ins; i++) {
+    if (leader[i]) {
+      b++;
+      cfg->blocks[b].start = (uint32_t)i;
+    }
+    cfg->blocks[b].end = (uint32_t)i+1;
+    cfg->block_of[i] = b;
+  }
+  free(leader);
+
+  // Successors: at most two per block, emitted in block order so the row
+  // offsets fall out directly
+  cfg->succ_off = (uint32_t*)realloc(cfg->succ_off, (n_blocks+1) * sizeof(uint32_t));
+  cfg->succ     = (uint32_t*)malloc(2 * n_blocks * sizeof(uint32_t));
+  cfg->exits    = (uint8_t*)calloc(n_blocks, 1);
+  uint32_t n_edges = 0;
+  for (b = 0; b < n_blocks; b++) {
+    cfg->succ_off[b] = n_edges;
+
+    uint32_t last = cfg->blocks[b].end - 1;
+    uint32_t fall = CFG_NONE;
+    if ((flow[last] == CFG_FLOW_NEXT || flow[last] == CFG_FLOW_COND) && last+1 < n_ins) {
+      fall = b+1;
+      cfg->succ[n_edges++] = fall;
+    }
+    if (target[last] != CFG_NONE) {
+      uint32_t t = cfg->block_of[target[last]];
+      if (t != fall) cfg->succ[n_edges++] = t;
+    }
+
+    // Returns, indirect jumps, branches out of the decoded range and running
+    // off its end all leave the function
+    if (flow[last] == CFG_FLOW_EXIT) cfg->exits[b] = 1;
+    if (flow[last] != CFG_FLOW_NEXT && flow[last] != CFG_FLOW_EXIT && target[last] == CFG_NONE) cfg->exits[b] = 1;
+    if (flow[last] != CFG_FLOW_JUMP && flow[last] != CFG_FLOW_EXIT && last+1 == n_ins) cfg->exits[b] = 1;
+  }
+  cfg->succ_off[n_blocks] = n_edges;
+  free(flow);
+  free(target);
+
+  // Predecessors: count, prefix-sum, scatter
+  cfg->pred_off = (uint32_t*)realloc(cfg->pred_off, (n_blocks+1) * sizeof(uint32_t));
+  cfg->pred     = (uint32_t*)malloc((n_edges ? n_edges : 1) * sizeof(uint32_t));
+  memset(cfg->pred_off, 0, (n_blocks+1) * sizeof(uint32_t));
+  for (uint32_t e = 0; e < n_edges; e++) cfg->pred_off[cfg->succ[e]+1]++;
+  for (b = 0; b < n_blocks; b++) cfg->pred_off[b+1] += cfg->pred_off[b];
+
+  uint32_t *cursor = (uint32_t*)malloc(n_blocks * sizeof(uint32_t));
+  memcpy(cursor, cfg->pred_off, n_blocks * sizeof(uint32_t));
+  for (b = 0; b < n_blocks; b++) {
+    for (uint32_t e = cfg->succ_off[b]; e < cfg->succ_off[b+1]; e++) {
+      cfg->pred[cursor[cfg->succ[e]]++] = b;
+    }
+  }
+  free(cursor);
+}
+
+void cfg_dump(cfg_t *cfg, dis86_instr_t *ins_arr)
+{
+  for (uint32_t b = 0; b < cfg->n_blocks; b++) {
+    cfg_block_t *blk = &cfg->blocks[b];
+    fprintf(stderr, "  block %-5u | %08zx .. %08zx | %5u ins | preds:",
+            b, ins_arr[blk->start].addr, ins_arr[blk->end-1].addr, blk->end - blk->start);
+    for (size_t i = 0; i < cfg_n_pred(cfg, b); i++) fprintf(stderr, " %u", cfg_pred(cfg, b)[i]);
+    fprintf(stderr, " | succs:");
+    for (size_t i = 0; i < cfg_n_succ(cfg, b); i++) fprintf(stderr, " %u", cfg_succ(cfg, b)[i]);
+    fprintf(stderr, "\n");
+  }
+}
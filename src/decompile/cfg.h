@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <unistd.h>
+
+#include "instr.h"
+
+// Control-flow graph over a decoded instruction array
+//
+// A block is the half-open instruction index range [start, end). Blocks are
+// numbered in address order and block 0 is the function entry. Edges are kept
+// in compressed sparse row form: the successors of block b are
+// succ[succ_off[b] .. succ_off[b+1]), and likewise for predecessors.
+//
+// Branches that leave the decoded range (tail jumps, indirect jumps, far
+// jumps, returns) simply have no successor edge.
+
+#define CFG_NONE UINT32_MAX
+
+typedef struct cfg_block cfg_block_t;
+struct cfg_block
+{
+  uint32_t start;
+  uint32_t end;
+};
+
+typedef struct cfg cfg_t;
+struct cfg
+{
+  uint32_t      n_blocks;
+  cfg_block_t * blocks;
+
+  uint32_t *    succ_off;   /* n_blocks+1 entries */
+  uint32_t *    succ;
+  uint32_t *    pred_off;   /* n_blocks+1 entries */
+  uint32_t *    pred;
+  uint8_t *     exits;      /* per block: control may leave the function from here */
+
+  uint32_t      n_ins;
+  uint32_t *    block_of;   /* instruction index -> block index */
+
+  /* Changes every time the graph is (re)built: analyses that cache results
+     derived from the graph compare against it to know when to recompute */
+  uint32_t      version;
+};
+
+typedef enum cfg_flow
+{
+  CFG_FLOW_NEXT,   /* falls through to the next instruction */
+  CFG_FLOW_COND,   /* falls through or branches to the target */
+  CFG_FLOW_JUMP,   /* always branches to the target */
+  CFG_FLOW_EXIT,   /* leaves the function (or goes somewhere we can't follow) */
+} cfg_flow_e;
+
+cfg_flow_e cfg_instr_flow(dis86_instr_t *ins, size_t *target);
+
+cfg_t * cfg_new(dis86_instr_t *ins_arr, size_t n_ins);
+void    cfg_delete(cfg_t *cfg);
+void    cfg_build(cfg_t *cfg, dis86_instr_t *ins_arr, size_t n_ins);
+void    cfg_dump(cfg_t *cfg, dis86_instr_t *ins_arr);
+
+static inline size_t cfg_n_succ(const cfg_t *cfg, uint32_t b) { return cfg->succ_off[b+1] - cfg->succ_off[b]; }
+static inline size_t cfg_n_pred(const cfg_t *cfg, uint32_t b) { return cfg->pred_off[b+1] - cfg->pred_off[b]; }
+static inline const uint32_t * cfg_succ(const cfg_t *cfg, uint32_t b) { return &cfg->succ[cfg->succ_off[b]]; }
+static inline const uint32_t * cfg_pred(const cfg_t *cfg, uint32_t b) { return &cfg->pred[cfg->pred_off[b]]; }
+
+static inline bool cfg_same_block(const cfg_t *cfg, size_t ins_a, size_t ins_b)
+{
+  return cfg->block_of[ins_a] == cfg->block_of[ins_b];
+}
@@ -1,27 +1,24 @@
 #include "config.h"
+#include "memo.h"
 #include "common/common.h"
+#include "common/hash.h"
+#include "common/stats.h"
+#include "common/fail.h"
 #include <cstdint>
 
 #include "dis86.h"
+#include "symbols.h"
 #include "bsl/bsl.h"
 
 dis86_decompile_config_t * config_default_new(void)
 {
   dis86_decompile_config_t * cfg = (dis86_decompile_config_t*)calloc(1, sizeof(dis86_decompile_config_t));
+  cfg->globals_symtab = symtab_shared_new(cfg);
   return cfg;
 }
 
-dis86_decompile_config_t * config_read_new(const char *path)
+static void config_parse(dis86_decompile_config_t *cfg, bsl::node_t *root)
 {
-  dis86_decompile_config_t * cfg = (dis86_decompile_config_t*)calloc(1, sizeof(dis86_decompile_config_t));
-
-
-  dynarray data = read_file(path);
-  if (data.empty()) FAIL("Failed to read file: '%s'", path);
-
-  bsl::node_t *root = bsl::parse_new(data, nullptr);
-  if (!root) FAIL("Failed to read the config");
-
   bsl::node_t *func = bsl::get_node(root, "dis86.functions");
   if (!func) FAIL("Failed to get functions node");
 
@@ -50,7 +47,7 @@ dis86_decompile_config_t * config_read_new(const char *path)
     int16_t args;
     if (!parse_bytes_int16_t(args_str, strlen(args_str), &args)) FAIL("Expected uint16_t for '%s.args', got '%s'", key, args_str);
 
-    assert(cfg->func_len < ARRAY_SIZE(cfg->func_arr));
+    if (cfg->func_len >= ARRAY_SIZE(cfg->func_arr)) FAIL("Too many functions in config (max %zu)", ARRAY_SIZE(cfg->func_arr));
     config_func_t *cf = &cfg->func_arr[cfg->func_len++];
     cf->name = strdup(key);
     cf->addr = parse_segoff(addr_str);
@@ -73,7 +70,7 @@ dis86_decompile_config_t * config_read_new(const char *path)
     const char *type_str = bsl::get_str(f, "type");
     if (!type_str) FAIL("No global type property for '%s'", key);
 
-    assert(cfg->global_len < ARRAY_SIZE(cfg->global_arr));
+    if (cfg->global_len >= ARRAY_SIZE(cfg->global_arr)) FAIL("Too many globals in config (max %zu)", ARRAY_SIZE(cfg->global_arr));
     config_global_t *g = &cfg->global_arr[cfg->global_len++];
     g->name   = strdup(key);
     g->offset = parse_hex_uint16_t(off_str, strlen(off_str));
@@ -96,13 +93,33 @@ dis86_decompile_config_t * config_read_new(const char *path)
     if (!to_str) FAIL("No segmap 'to' property for '%s'", key);
     uint16_t to = parse_hex_uint16_t(to_str, strlen(to_str));
 
-    assert(cfg->segmap_len < ARRAY_SIZE(cfg->segmap_arr));
+    if (cfg->segmap_len >= ARRAY_SIZE(cfg->segmap_arr)) FAIL("Too many segmaps in config (max %zu)", ARRAY_SIZE(cfg->segmap_arr));
     config_segmap_t *sm = &cfg->segmap_arr[cfg->segmap_len++];
     sm->name = strdup(key);
     sm->from = from;
     sm->to = to;
   }
+}
+
+dis86_decompile_config_t * config_read_new(const char *path)
+{
+  dynarray data = read_file(path);
+  if (data.empty()) FAIL("Failed to read file: '%s'", path);
+
+  bsl::node_t *root = bsl::parse_new(data, nullptr);
+  if (!root) FAIL("Failed to read the config");
+
+  dis86_decompile_config_t * cfg = (dis86_decompile_config_t*)calloc(1, sizeof(dis86_decompile_config_t));
 
+  // FAIL throws under dis86_decompile_config_read_checked
+  try {
+    config_parse(cfg, root);
+    cfg->globals_symtab = symtab_shared_new(cfg);
+  } catch (...) {
+    bsl::free_node(root);
+    config_delete(cfg);
+    throw;
+  }
 
   bsl::free_node(root);
   return cfg;
@@ -113,6 +130,7 @@ void config_delete(dis86_decompile_config_t *cfg)
   if (!cfg) return;
   for (size_t i = 0; i < cfg->func_len; i++) {
     free(cfg->func_arr[i].name);
+    free(cfg->func_arr[i].ret);
   }
   for (size_t i = 0; i < cfg->global_len; i++) {
     free(cfg->global_arr[i].name);
@@ -121,9 +139,18 @@ void config_delete(dis86_decompile_config_t *cfg)
   for (size_t i = 0; i < cfg->segmap_len; i++) {
     free(cfg->segmap_arr[i].name);
   }
+  memo_delete(cfg->memo);
+  symtab_shared_unref(cfg->globals_symtab);
   free(cfg);
 }
 
+void config_globals_changed(dis86_decompile_config_t *cfg)
+{
+  symtab_shared_t *old = cfg->globals_symtab;
+  cfg->globals_symtab = symtab_shared_new(cfg);
+  symtab_shared_unref(old);
+}
+
 void config_print(dis86_decompile_config_t *cfg)
 {
   printf("functions:\n");
@@ -147,12 +174,14 @@ void config_print(dis86_decompile_config_t *cfg)
 
 config_func_t * config_func_lookup(dis86_decompile_config_t *cfg, segoff_t s)
 {
+  STAT_INC(CONFIG_FUNC_LOOKUP);
   for (size_t i = 0; i < cfg->func_len; i++) {
     config_func_t *f = &cfg->func_arr[i];
     if (f->addr.seg == s.seg && f->addr.off == s.off) {
       return f;
     }
   }
+  STAT_INC(CONFIG_FUNC_LOOKUP_MISS);
   return nullptr;
 }
 
@@ -169,8 +198,177 @@ bool config_seg_remap(dis86_decompile_config_t *cfg, uint16_t *_seg)
   return false;
 }
 
+static bool str_eq(const char *a, const char *b)
+{
+  return a == b || (a && b && 0 == strcmp(a, b));
+}
+
+static config_func_t * find_func(dis86_decompile_config_t *cfg, segoff_t addr)
+{
+  for (size_t i = 0; i < cfg->func_len; i++) {
+    config_func_t *f = &cfg->func_arr[i];
+    if (f->addr.seg == addr.seg && f->addr.off == addr.off) return f;
+  }
+  return nullptr;
+}
+
+static config_global_t * find_global(dis86_decompile_config_t *cfg, uint16_t offset)
+{
+  for (size_t i = 0; i < cfg->global_len; i++) {
+    if (cfg->global_arr[i].offset == offset) return &cfg->global_arr[i];
+  }
+  return nullptr;
+}
+
+static config_segmap_t * find_segmap(dis86_decompile_config_t *cfg, uint16_t from)
+{
+  for (size_t i = 0; i < cfg->segmap_len; i++) {
+    if (cfg->segmap_arr[i].from == from) return &cfg->segmap_arr[i];
+  }
+  return nullptr;
+}
+
+void config_take_cache(dis86_decompile_config_t *cfg, dis86_decompile_config_t *old_cfg,
+                       dis86_decompile_config_diff_t *opt_diff)
+{
+  // Entries are matched on address (offset, source segment): those edited or
+  // removed are counted from the old side, those added from the new
+  dis86_decompile_config_diff_t diff[1] = {};
+  for (size_t i = 0; i < old_cfg->func_len; i++) {
+    config_func_t *f = &old_cfg->func_arr[i];
+    config_func_t *g = find_func(cfg, f->addr);
+    if (!g || !str_eq(f->name, g->name) || !str_eq(f->ret, g->ret) ||
+        f->args != g->args || f->pop_args_after_call != g->pop_args_after_call) diff->funcs++;
+  }
+  for (size_t i = 0; i < cfg->func_len; i++) {
+    if (!find_func(old_cfg, cfg->func_arr[i].addr)) diff->funcs++;
+  }
+
+  for (size_t i = 0; i < old_cfg->global_len; i++) {
+    config_global_t *f = &old_cfg->global_arr[i];
+    config_global_t *g = find_global(cfg, f->offset);
+    if (!g || !str_eq(f->name, g->name) || !str_eq(f->type, g->type)) diff->globals++;
+  }
+  for (size_t i = 0; i < cfg->global_len; i++) {
+    if (!find_global(old_cfg, cfg->global_arr[i].offset)) diff->globals++;
+  }
+
+  for (size_t i = 0; i < old_cfg->segmap_len; i++) {
+    config_segmap_t *f = &old_cfg->segmap_arr[i];
+    config_segmap_t *g = find_segmap(cfg, f->from);
+    if (!g || !str_eq(f->name, g->name) || f->to != g->to) diff->segmaps++;
+  }
+  for (size_t i = 0; i < cfg->segmap_len; i++) {
+    if (!find_segmap(old_cfg, cfg->segmap_arr[i].from)) diff->segmaps++;
+  }
+
+  memo_t *memo = old_cfg->memo;
+  old_cfg->memo = nullptr;
+  if (memo) {
+    // Nothing changed: the entries only need repointing at the new copies
+    bool changed = diff->funcs || diff->globals || diff->segmaps;
+    diff->invalidated = memo_rebind(memo, cfg, changed);
+    diff->kept = memo_size(memo);
+    memo_delete(cfg->memo);
+    cfg->memo = memo;
+  }
+
+  if (opt_diff) *opt_diff = *diff;
+}
+
 dis86_decompile_config_t * dis86_decompile_config_read_new(const char *path)
 { return config_read_new(path); }
 
+dis86_decompile_config_t * dis86_decompile_config_read_checked(const char *path, dis86_error_t *err)
+{
+  try {
+    fail_recover recover;
+    return config_read_new(path);
+  } catch (const fail_error& e) {
+    if (err) {
+      err->addr = 0;
+      snprintf(err->msg, sizeof(err->msg), "%s", e.msg);
+    }
+    return nullptr;
+  }
+}
+
+dis86_decompile_config_t * dis86_decompile_config_default_new(void)
+{ return config_default_new(); }
+
 void dis86_decompile_config_delete(dis86_decompile_config_t *cfg)
 { config_delete(cfg); }
+
+void dis86_decompile_config_take_cache(dis86_decompile_config_t *cfg, dis86_decompile_config_t *old_cfg,
+                                       dis86_decompile_config_diff_t *opt_diff)
+{ config_take_cache(cfg, old_cfg, opt_diff); }
+
+static uint64_t hash_func(uint64_t h, config_func_t *f)
+{
+  if (!f) return hash_u64(h, 0);
+  h = hash_u64(h, 1);
+  h = hash_str(h, f->name);
+  h = hash_str(h, f->ret);
+  h = hash_u64(h, (uint64_t)(int64_t)f->args);
+  return hash_u64(h, f->pop_args_after_call);
+}
+
+uint64_t config_deps_hash(dis86_decompile_config_t *cfg, uint16_t seg, dis86_instr_t *ins_arr, size_t n_ins)
+{
+  // Mirrors the lookups that the decompiler makes: call targets (after
+  // segment remapping) and globals referenced through DS. Entries that no
+  // instruction reaches don't contribute, so editing an unrelated function
+  // or global doesn't invalidate this one.
+  uint64_t h = HASH_INIT;
+  if (!cfg) return h;
+
+  for (size_t i = 0; i < n_ins; i++) {
+    dis86_instr_t *ins = &ins_arr[i];
+    operand_t *o = &ins->operand[0];
+
+    if (ins->opcode == operation_e::CALLF && o->type == OPERAND_TYPE_FAR) {
+      segoff_t addr = {o->u.far.seg, o->u.far.off};
+      bool remapped = config_seg_remap(cfg, &addr.seg);
+      h = hash_u64(h, ((uint64_t)remapped << 32) | ((uint64_t)addr.seg << 16) | addr.off);
+      h = hash_func(h, config_func_lookup(cfg, addr));
+    }
+    else if (ins->opcode == operation_e::CALL && o->type == OPERAND_TYPE_REL) {
+      uint16_t off = (uint16_t)(ins->addr + ins->n_bytes + o->u.rel.val - 16*(size_t)seg);
+      h = hash_func(h, config_func_lookup(cfg, segoff_t{seg, off}));
+    }
+
+    for (size_t j = 0; j < ARRAY_SIZE(ins->operand); j++) {
+      operand_mem_t *m = &ins->operand[j].u.mem;
+      if (ins->operand[j].type != OPERAND_TYPE_MEM) continue;
+      if (m->sreg != REG_DS || m->reg1 || m->reg2) continue;
+
+      int lo = (int16_t)m->off;
+      int hi = lo + (m->sz == SIZE_8 ? 1 : m->sz == SIZE_16 ? 2 : 4);
+      // Which of the overlapping globals wins goes by config order, so their
+      // rank among each other matters but not where they sit in the config
+      const symtab_shared_t *gs = cfg->globals_symtab;
+      size_t first = symtab_shared_lower(gs, lo - gs->max_len + 1);
+      auto overlaps = [&](size_t k) {
+        const sym_t *sym = &gs->tab.var[k];
+        return lo < sym->off + sym->len && sym->off < hi;
+      };
+      for (size_t k = first; k < gs->tab.n_var && gs->tab.var[k].off < hi; k++) {
+        if (!overlaps(k)) continue;
+        size_t rank = 0;
+        for (size_t r = first; r < gs->tab.n_var && gs->tab.var[r].off < hi; r++) {
+          if (overlaps(r) && gs->cfg_idx[r] < gs->cfg_idx[k]) rank++;
+        }
+        config_global_t *g = &cfg->global_arr[gs->cfg_idx[k]];
+        h = hash_u64(h, rank);
+        h = hash_str(h, g->name);
+        h = hash_str(h, g->type);
+        h = hash_u64(h, g->offset);
+      }
+    }
+  }
+  return h;
+}
+
+uint64_t dis86_decompile_config_deps_hash(dis86_decompile_config_t *cfg, uint16_t seg,
+                                          dis86_instr_t *ins, size_t n_ins)
+{ return config_deps_hash(cfg, seg, ins, n_ins); }
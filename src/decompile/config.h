@@ -10,6 +10,11 @@ typedef struct config_func            config_func_t;
 typedef struct config_global          config_global_t;
 typedef struct config_segmap          config_segmap_t;
 
+struct dis86_instr_t;
+struct symtab_shared_t;
+typedef struct memo memo_t;
+typedef struct dis86_decompile_config_diff dis86_decompile_config_diff_t;
+
 struct config_func
 {
   char *   name;
@@ -43,12 +48,25 @@ struct dis86_decompile_config_t
 
   size_t          segmap_len;
   config_segmap_t segmap_arr[MAX_CONFIG_SEGMAPS];
+
+  symtab_shared_t * globals_symtab;  // the globals above as symbols, sorted by offset
+  memo_t *        memo;  // decompile results keyed by function content, created on first use
 };
 
 dis86_decompile_config_t *      config_read_new(const char *path);
 dis86_decompile_config_t *      config_default_new(void);
 void            config_delete(dis86_decompile_config_t *cfg);
 
+/* Rebuilds globals_symtab: call after editing global_arr in place */
+void            config_globals_changed(dis86_decompile_config_t *cfg);
+
 void            config_print(dis86_decompile_config_t *cfg);
 config_func_t * config_func_lookup(dis86_decompile_config_t *cfg, segoff_t s);
 bool            config_seg_remap(dis86_decompile_config_t *cfg, uint16_t *inout_seg);
+
+/* Moves old_cfg's memo to cfg, keeping the entries the differences don't reach */
+void            config_take_cache(dis86_decompile_config_t *cfg, dis86_decompile_config_t *old_cfg,
+                                  dis86_decompile_config_diff_t *opt_diff);
+
+/* Hash of the config entries that decompiling ins[0..n_ins) would consult */
+uint64_t        config_deps_hash(dis86_decompile_config_t *cfg, uint16_t seg, dis86_instr_t *ins, size_t n_ins);
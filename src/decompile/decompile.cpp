@@ -1,8 +1,13 @@
 #include "decompile_private.h"
 
 #include <format>
+#include <string>
+#include <string_view>
 
-#define DEBUG_REPORT_SYMBOLS 0
+#define DEBUG_REPORT_SYMBOLS  0
+#define DEBUG_REPORT_CFG      0
+#define DEBUG_REPORT_SSA      0
+#define DEBUG_REPORT_LIVENESS 0
 
 
 static const char *n_bytes_as_type(uint16_t n_bytes)
@@ -15,12 +20,56 @@ static const char *n_bytes_as_type(uint16_t n_bytes)
   }
 }
 
+static dis86_decompile_phase_fn_t phase_fn   = nullptr;
+static void *                     phase_user = nullptr;
+
+void dis86_decompile_set_phase_observer(dis86_decompile_phase_fn_t fn, void *user)
+{
+  phase_fn   = fn;
+  phase_user = user;
+}
+
+// Brackets the rest of the enclosing scope as one phase for the observer,
+// and times it for --stats as "decompile.<name>"
+struct phase_scope
+{
+  const char *name;
+  phase_scope(const char *name) : name(name) { if (phase_fn) phase_fn(phase_user, name, false); }
+  ~phase_scope() { if (phase_fn) phase_fn(phase_user, name, true); }
+};
+#define PHASE(name) phase_scope _phase(name); STAT_TIMER("decompile." name)
+
+// Everything one decompile builds is carved from a per-thread arena, which
+// the next decompile on the thread resets wholesale: tearing a function down
+// costs nothing and the next one runs on the same warm pages
+#define SESSION_ARENA_CHUNK (256 << 10)
+
+static arena_t * session_arena(void)
+{
+  static thread_local struct session {
+    arena_t *arena = arena_new(SESSION_ARENA_CHUNK);
+    ~session() { arena_delete(arena); }
+  } s;
+  return s.arena;
+}
+
+// Text built during emit lives in the arena as well
+typedef std::pmr::string str_t;
+
+// Stands in for a missing config. Never modified: only a caller-supplied
+// config gets a memo.
+static dis86_decompile_config_t * empty_config(void)
+{
+  static dis86_decompile_config_t *cfg = config_default_new();
+  return cfg;
+}
+
 typedef struct decompiler decompiler_t;
 struct decompiler
 {
+  arena_t *                  arena;
   dis86_t *                  dis;
   dis86_decompile_config_t * cfg;
-  dis86_decompile_config_t * default_cfg;
   const char *               func_name;
   uint16_t                        seg;
   dis86_instr_t *            ins;
@@ -28,11 +77,17 @@ struct decompiler
 
   symbols_t * symbols;
   labels_t    labels[1];
+  cfg_t *     cfg_graph;
+  dom_t *     dom;
 
   meh_t *meh;
+  ssa_t *ssa;
+  liveness_t *liveness;
+  escape_t *escape;
 };
 
-static decompiler_t * decompiler_new( dis86_t *                  dis,
+static decompiler_t * decompiler_new( arena_t *                  arena,
+                                      dis86_t *                  dis,
                                       dis86_decompile_config_t * opt_cfg,
                                       const char *               func_name,
                                       uint16_t                        seg,
@@ -40,37 +95,35 @@ static decompiler_t * decompiler_new( dis86_t *                  dis,
                                       size_t                     n_ins )
 
 {
-  decompiler_t *d = (decompiler_t*)calloc(1, sizeof(decompiler_t));
-  d->dis = dis;
-  d->cfg = opt_cfg;
-  if (!d->cfg) {
-    d->default_cfg = config_default_new();
-    d->cfg = d->default_cfg;
-  }
+  decompiler_t *d = arena_calloc<decompiler_t>(arena, 1);
+  d->arena     = arena;
+  d->dis       = dis;
+  d->cfg       = opt_cfg ? opt_cfg : empty_config();
   d->func_name = func_name;
   d->seg       = seg;
   d->ins       = ins_arr;
   d->n_ins     = n_ins;
-
-  d->symbols = symbols_new();
-  d->meh = nullptr;
   return d;
 }
 
 static void decompiler_delete(decompiler_t *d)
 {
+  if (d->liveness) liveness_delete(d->liveness);
+  if (d->ssa) ssa_delete(d->ssa);
   if (d->meh) meh_delete(d->meh);
-  if (d->default_cfg) config_delete(d->default_cfg);
-  symbols_delete(d->symbols);
-  free(d);
+  if (d->dom) dom_delete(d->dom);
+  if (d->cfg_graph) cfg_delete(d->cfg_graph);
+  if (d->symbols) symbols_delete(d->symbols);
+  labels_release(d->labels);
+  // the decompiler itself goes with the arena
 }
 
-static void dump_symtab(symtab_t *symtab)
+static void dump_symtab(const symtab_t *symtab)
 {
   symtab_iter_t it[1];
   symtab_iter_begin(it, symtab);
   while (1) {
-    sym_t *var = symtab_iter_next(it);
+    const sym_t *var = symtab_iter_next(it);
     if (!var) break;
 
     const char *size;
@@ -86,49 +139,103 @@ static void dump_symtab(symtab_t *symtab)
 static void decompiler_initial_analysis(decompiler_t *d)
 {
   // Pass to find all labels
-  find_labels(d->labels, d->ins, d->n_ins);
+  {
+    PHASE("find_labels");
+    find_labels(d->labels, d->ins, d->n_ins);
+  }
 
-  // Populate registers
-  for (int reg_id = 1; reg_id < _REG_LAST; reg_id++) {
-    sym_t deduced_sym[1];
-    sym_deduce_reg(deduced_sym, reg_id);
-    if (deduced_sym->len != 2) continue; // skip the small overlap regs
-    symbols_insert_deduced(d->symbols, deduced_sym);
+  // Split into basic blocks
+  {
+    PHASE("cfg");
+    d->cfg_graph = cfg_new(d->ins, d->n_ins);
   }
 
-  // Load all global symbols from config into the symtab
-  for (size_t i = 0; i < d->cfg->global_len; i++) {
-    config_global_t *g = &d->cfg->global_arr[i];
+  // Dominators and loop nesting
+  {
+    PHASE("dom");
+    d->dom = dom_new();
+    dom_update(d->dom, d->cfg_graph);
+  }
+
+  {
+    PHASE("symbols");
+    d->symbols = symbols_new(d->cfg->globals_symtab, d->arena);
+
+    // Pass to locate all symbols. Registers and globals come prebuilt with the
+    // config (see symbols_new): only params and locals are per function
+    for (size_t i = 0; i < d->n_ins; i++) {
+      dis86_instr_t *ins = &d->ins[i];
+
+      for (size_t j = 0; j < ARRAY_SIZE(ins->operand); j++) {
+        operand_t *o = &ins->operand[j];
+        if (o->type != OPERAND_TYPE_MEM) continue;
 
-    type_t type[1];
-    if (!type_parse(type, g->type)) {
-      LOG_WARN("For global '%s', failed to parse type '%s' ... skipping", g->name, g->type);
-      continue;
+        sym_t deduced_sym[1];
+        if (!sym_deduce(deduced_sym, &o->u.mem)) continue;
+
+        if (!symbols_insert_deduced(d->symbols, deduced_sym)) {
+          std::string name = sym_name(deduced_sym);
+          LOG_WARN("Unknown global | name: %s  off: 0x%04x  size: %u", name.c_str(), (uint16_t)deduced_sym->off, deduced_sym->len);
+        }
+      }
     }
+  }
 
-    symbols_add_global(d->symbols, g->name, g->offset, type_size(type));
+  // Pass to convert to expression structures
+  {
+    PHASE("meh_new");
+    d->meh = meh_new(d->cfg, d->symbols, d->seg, d->ins, d->n_ins, d->arena);
   }
 
-  // Pass to locate all symbols
-  for (size_t i = 0; i < d->n_ins; i++) {
-    dis86_instr_t *ins = &d->ins[i];
+  // Peephole passes over the expressions
+  { PHASE("xor_rr");           transform_pass_xor_rr(d->meh); }
+  { PHASE("cmp_jmp");          transform_pass_cmp_jmp(d->meh); }
+  { PHASE("or_jmp");           transform_pass_or_jmp(d->meh); }
+  { PHASE("synthesize_calls"); transform_pass_synthesize_calls(d->meh); }
+  { PHASE("long_ops");         transform_pass_long_ops(d->meh, d->symbols, d->cfg_graph, d->ins); }
+  { PHASE("rep_string");       transform_pass_rep_string(d->meh, d->symbols, d->cfg_graph, d->ins); }
 
-    for (size_t j = 0; j < ARRAY_SIZE(ins->operand); j++) {
-      operand_t *o = &ins->operand[j];
-      if (o->type != OPERAND_TYPE_MEM) continue;
+  // SSA overlay with def-use chains
+  {
+    PHASE("ssa");
+    d->ssa = ssa_new(d->meh, d->symbols, d->cfg_graph, d->dom, d->ins);
+  }
 
-      sym_t deduced_sym[1];
-      if (!sym_deduce(deduced_sym, &o->u.mem)) continue;
+  // Lazy flags: fold compares into the branches that consume them, then drop
+  // every flag producer whose result is never observed
+  {
+    PHASE("fuse_flags");
+    transform_pass_fuse_flags(d->meh, d->ssa);
+  }
+  {
+    PHASE("lazy_flags");
+    flags_t *flags = flags_new(d->meh, d->cfg_graph, d->dom, d->ins);
+    transform_pass_lazy_flags(d->meh, flags);
+    flags_delete(flags);
+  }
 
-      if (!symbols_insert_deduced(d->symbols, deduced_sym)) {
-        std::string name = sym_name(deduced_sym);
-        LOG_WARN("Unknown global | name: %s  off: 0x%04x  size: %u", name.c_str(), (uint16_t)deduced_sym->off, deduced_sym->len);
-      }
+  // Dead stores: drop register writes nothing reads. Each round can expose
+  // more (the last read of a value may itself have gone), so repeat until
+  // the liveness holds still.
+  {
+    PHASE("dead_stores");
+    while (1) {
+      flags_t *flags = flags_new(d->meh, d->cfg_graph, d->dom, d->ins);
+      d->liveness = liveness_new(d->meh, d->symbols, d->cfg_graph, d->dom, d->ins);
+      bool changed = transform_pass_dead_stores(d->meh, d->liveness, flags);
+      flags_delete(flags);
+      if (!changed) break;
+      liveness_delete(d->liveness);
+      d->liveness = nullptr;
     }
   }
 
-  // Pass to convert to expression structures
-  d->meh = meh_new(d->cfg, d->symbols, d->seg, d->ins, d->n_ins);
+  // Only the report reads the SSA past the flag passes: rebuild it for that
+  if (DEBUG_REPORT_SSA) {
+    PHASE("ssa");
+    ssa_delete(d->ssa);
+    d->ssa = ssa_new(d->meh, d->symbols, d->cfg_graph, d->dom, d->ins);
+  }
 
   // Report the symbols
   if (DEBUG_REPORT_SYMBOLS) {
@@ -141,37 +248,83 @@ static void decompiler_initial_analysis(decompiler_t *d)
     LOG_INFO("Locals:");
     dump_symtab(d->symbols->locals);
   }
+
+  if (DEBUG_REPORT_CFG) {
+    LOG_INFO("Basic blocks:");
+    cfg_dump(d->cfg_graph, d->ins);
+    LOG_INFO("Dominators:");
+    dom_dump(d->dom);
+  }
+
+  if (DEBUG_REPORT_SSA) {
+    LOG_INFO("SSA:");
+    ssa_dump(d->ssa, d->meh);
+  }
+
+  if (DEBUG_REPORT_LIVENESS) {
+    LOG_INFO("Liveness:");
+    liveness_dump(d->liveness);
+  }
 }
 
-static void decompiler_emit_preamble(decompiler_t *d, std::string& s)
+static void decompiler_emit_preamble(decompiler_t *d, str_t& s)
 {
   symtab_iter_t it[1];
 
   // Emit params
   symtab_iter_begin(it, d->symbols->params);
   while (1) {
-    sym_t *var = symtab_iter_next(it);
+    const sym_t *var = symtab_iter_next(it);
     if (!var) break;
 
+    if (escape_promoted(d->escape, d->symbols, var)) continue;
     std::string name = sym_name(var);
-    s += std::format<"#define %s ARG_%zu(0x%x)\n">(name, 8*sym_size_bytes(var), var->off);
+    std::format_to<"#define %s ARG_%zu(0x%x)\n">(std::back_inserter(s), name, 8*sym_size_bytes(var), var->off);
   }
 
   // Emit locals
   symtab_iter_begin(it, d->symbols->locals);
   while (1) {
-    sym_t *var = symtab_iter_next(it);
+    const sym_t *var = symtab_iter_next(it);
     if (!var) break;
 
+    if (escape_promoted(d->escape, d->symbols, var)) continue;
     std::string name = sym_name(var);
-    s += std::format<"#define %s LOCAL_%zu(0x%x)\n">(name, 8*sym_size_bytes(var), -var->off);
+    std::format_to<"#define %s LOCAL_%zu(0x%x)\n">(std::back_inserter(s), name, 8*sym_size_bytes(var), -var->off);
   }
 
-  s += std::format<"void %s(void)\n">(d->func_name);
+  std::format_to<"void %s(void)\n">(std::back_inserter(s), d->func_name);
   s += "{\n";
+
+  // Slots nothing else can reach are plain variables
+  for (const symtab_t *tab : {d->symbols->params, d->symbols->locals}) {
+    symtab_iter_begin(it, tab);
+    while (1) {
+      const sym_t *var = symtab_iter_next(it);
+      if (!var) break;
+      if (!escape_promoted(d->escape, d->symbols, var)) continue;
+
+      std::format_to<"  %s %s;\n">(std::back_inserter(s), n_bytes_as_type(var->len), sym_name(var));
+    }
+  }
 }
 
-static void decompiler_emit_postamble(decompiler_t *d, std::string& s)
+// Promoted params start out as what the caller pushed, readable once the
+// frame is set up
+static void decompiler_emit_param_loads(decompiler_t *d, str_t& s)
+{
+  symtab_iter_t it[1];
+  symtab_iter_begin(it, d->symbols->params);
+  while (1) {
+    const sym_t *var = symtab_iter_next(it);
+    if (!var) break;
+    if (!escape_promoted(d->escape, d->symbols, var)) continue;
+
+    std::format_to<"  %s = ARG_%zu(0x%x);\n">(std::back_inserter(s), sym_name(var), 8*sym_size_bytes(var), var->off);
+  }
+}
+
+static void decompiler_emit_postamble(decompiler_t *d, str_t& s)
 {
   symtab_iter_t it[1];
 
@@ -179,69 +332,68 @@ static void decompiler_emit_postamble(decompiler_t *d, std::string& s)
 
   // Cleanup params
   symtab_iter_begin(it, d->symbols->params);
-  sym_t* var = nullptr;
+  const sym_t* var = nullptr;
   while (var = symtab_iter_next(it), var != nullptr)
-    s += std::format<"#undef %s\n">(sym_name(var));
+    if (!escape_promoted(d->escape, d->symbols, var))
+      std::format_to<"#undef %s\n">(std::back_inserter(s), sym_name(var));
 
   // Cleanup locals
   symtab_iter_begin(it, d->symbols->locals);
   while (var = symtab_iter_next(it), var != nullptr)
-    s += std::format<"#undef %s\n">(sym_name(var));
+    if (!escape_promoted(d->escape, d->symbols, var))
+      std::format_to<"#undef %s\n">(std::back_inserter(s), sym_name(var));
 }
 
-std::string short_name(const std::string& name, size_t off, size_t n_bytes)
+static bool short_name(str_t& s, const std::string& name, size_t off, size_t n_bytes)
 {
-  std::string tmp;
   if (name == "AX" ||
       name == "BX" ||
       name == "CX" ||
       name == "DX")
   {
-    tmp.push_back(name.front());
+    s.push_back(name.front());
     assert(n_bytes == 1 && (off == 0 || off == 1));
-    tmp.push_back(!off ? 'L' : 'H');
+    s.push_back(!off ? 'L' : 'H');
+    return true;
   }
-  return tmp;
+  return false;
 }
 
-static std::string symref_lvalue_str(symref_t ref, const std::string& name)
+static void symref_lvalue_str(str_t& s, symref_t ref, const sym_t *sym)
 {
-  assert(ref.symbol);
-  std::string s;
-
-  if (ref.off == 0 && ref.len == ref.symbol->len)
-    s = name;
-  else if(s = short_name(name, ref.off, ref.len); s.empty())
-    s = std::format<"*(%s*)((uint8_t*)&%s + %u)">(n_bytes_as_type(ref.len), name, ref.off);
-  return s;
+  assert(sym);
+  std::string name = sym_name(sym);
+
+  if (ref.off == 0 && ref.len == sym->len)
+    s += name;
+  else if (!short_name(s, name, ref.off, ref.len))
+    std::format_to<"*(%s*)((uint8_t*)&%s + %u)">(std::back_inserter(s), n_bytes_as_type(ref.len), name, ref.off);
 }
 
-static std::string symref_rvalue_str(symref_t ref, const std::string& name)
+static void symref_rvalue_str(str_t& s, symref_t ref, const sym_t *sym)
 {
-  std::string s;
-  assert(ref.symbol);
+  assert(sym);
+  std::string name = sym_name(sym);
   if (ref.off == 0)
   {
-    if (ref.len == ref.symbol->len)
-      s = name;
+    if (ref.len == sym->len)
+      s += name;
     else
-      s = std::format<"(%s)%s">(n_bytes_as_type(ref.len), name);
+      std::format_to<"(%s)%s">(std::back_inserter(s), n_bytes_as_type(ref.len), name);
   }
-  else if(s = short_name(name, ref.off, ref.len); s.empty())
-    s = std::format<"(%s)(%s>>%u)">(n_bytes_as_type(ref.len), name, (8 * ref.off));
-  return s;
+  else if (!short_name(s, name, ref.off, ref.len))
+    std::format_to<"(%s)(%s>>%u)">(std::back_inserter(s), n_bytes_as_type(ref.len), name, (8 * ref.off));
 }
 
-static std::string value_str(value_t *v, bool as_lvalue)
+static void value_str(str_t& s, const symbols_t *symbols, value_t *v, bool as_lvalue)
 {
-  std::string s;
-
   switch (v->type) {
     case VALUE_TYPE_SYM: {
+      symref_t ref = v->u.sym->ref;
       if (as_lvalue) {
-        s += symref_lvalue_str(v->u.sym->ref, sym_name(v->u.sym->ref.symbol));
+        symref_lvalue_str(s, ref, symbols_sym(symbols, ref.id));
       } else {
-        s += symref_rvalue_str(v->u.sym->ref, sym_name(v->u.sym->ref.symbol));
+        symref_rvalue_str(s, ref, symbols_sym(symbols, ref.id));
       }
     } break;
     case VALUE_TYPE_MEM: {
@@ -251,24 +403,26 @@ static std::string value_str(value_t *v, bool as_lvalue)
         case SIZE_16: s += "*PTR_16("; break;
         case SIZE_32: s += "*PTR_32("; break;
       }
-      s += sym_name(m->sreg.symbol) + ", ";
-      // FIXME: THIS IS ALL BROKEN BECAUSE IT ASSUMES THE SYMREF ARE NEVER PARTIAL REFS
-      if (!m->reg1.symbol && !m->reg2.symbol)
+      s += reg_name_upper(m->sreg);
+      s += ", ";
+      if (!m->reg1 && !m->reg2)
       {
         if (m->off)
-          s += std::format<"0x%x">(m->off);
+          std::format_to<"0x%x">(std::back_inserter(s), m->off);
       }
       else
       {
-        if (m->reg1.symbol)
-          s += sym_name(m->reg1.symbol);
-        if (m->reg2.symbol)
-          s += "+" + sym_name(m->reg2.symbol);
+        if (m->reg1)
+          s += reg_name_upper(m->reg1);
+        if (m->reg2) {
+          s += "+";
+          s += reg_name_upper(m->reg2);
+        }
         if (m->off) {
           int16_t disp = (int16_t)m->off;
           /* if (disp >= 0) str_fmt(s, "+0x%x", (uint16_t)disp); */
           /* else           str_fmt(s, "-0x%x", (uint16_t)-disp); */
-          s += std::format<"+0x%x">((uint16_t)disp);
+          std::format_to<"+0x%x">(std::back_inserter(s), (uint16_t)disp);
         }
       }
       s += ")";
@@ -278,19 +432,81 @@ static std::string value_str(value_t *v, bool as_lvalue)
       if (val == 0)
         s += "0";
       else
-        s += std::format<"0x%x">(val);
+        std::format_to<"0x%x">(std::back_inserter(s), val);
     } break;
     default: FAIL("Unknown value type: %d\n", v->type);
   }
-  return s;
 }
 
-static void decompiler_emit_expr(decompiler_t *d, std::string& ret_s, expr_t *expr)
+// A 32-bit value from its halves ([0] low, [1] high). Halves that sit side by
+// side in memory read and write as one; anything else is only an rvalue and
+// nothing is appended for the lvalue.
+static bool value32_str(str_t& s, const symbols_t *symbols, value_t *v, bool as_lvalue)
+{
+  value_t *lo = &v[0], *hi = &v[1];
+  if (VALUE_IS_NONE(*hi)) {
+    value_str(s, symbols, lo, as_lvalue);
+    return true;
+  }
+
+  if (lo->type == VALUE_TYPE_IMM && hi->type == VALUE_TYPE_IMM) {
+    uint32_t val = (uint32_t)hi->u.imm->value << 16 | lo->u.imm->value;
+    if (val == 0)
+      s += "0";
+    else
+      std::format_to<"0x%x">(std::back_inserter(s), val);
+    return true;
+  }
+
+  if (lo->type == VALUE_TYPE_MEM && hi->type == VALUE_TYPE_MEM) {
+    value_mem_t *a = lo->u.mem, *b = hi->u.mem;
+    if (a->sz == SIZE_16 && b->sz == SIZE_16 && a->sreg == b->sreg && a->reg1 == b->reg1 && a->reg2 == b->reg2 &&
+        (uint16_t)(a->off + 2) == b->off) {
+      value_t w = *lo;
+      w.u.mem->sz = SIZE_32;
+      value_str(s, symbols, &w, as_lvalue);
+      return true;
+    }
+  }
+
+  if (lo->type == VALUE_TYPE_SYM && hi->type == VALUE_TYPE_SYM) {
+    symref_t a = lo->u.sym->ref, b = hi->u.sym->ref;
+    if (a.len == 2 && b.len == 2) {
+      // Both halves of one symbol
+      if (a.id == b.id && a.off + 2 == b.off) {
+        value_t w = *lo;
+        w.u.sym->ref.len = 4;
+        value_str(s, symbols, &w, as_lvalue);
+        return true;
+      }
+
+      // Neighbouring words of the stack frame
+      int kind = SYM_ID_KIND(a.id);
+      const sym_t *sa = symbols_sym(symbols, a.id), *sb = symbols_sym(symbols, b.id);
+      if ((kind == SYM_KIND_PARAM || kind == SYM_KIND_LOCAL) && SYM_ID_KIND(b.id) == kind &&
+          a.off == 0 && b.off == 0 && sa->len == 2 && sb->len == 2 && sa->off + 2 == sb->off) {
+        std::format_to<"*(uint32_t*)&%s">(std::back_inserter(s), sym_name(sa));
+        return true;
+      }
+    }
+  }
+
+  if (as_lvalue) return false;
+  s += "((uint32_t)";
+  value_str(s, symbols, hi, false);
+  s += " << 16 | ";
+  value_str(s, symbols, lo, false);
+  s += ")";
+  return true;
+}
+
+static void decompiler_emit_expr(decompiler_t *d, str_t& ret_s, expr_t *expr)
 {
-  std::string s;
+  str_t s(ret_s.get_allocator());
   switch (expr->kind) {
     case EXPR_KIND_NONE: {
-      return;
+      // Dropped exprs still list their instructions
+      if (!expr->n_ins) return;
     } break;
     case EXPR_KIND_UNKNOWN: {
       s += "UNKNOWN();";
@@ -298,42 +514,86 @@ static void decompiler_emit_expr(decompiler_t *d, std::string& ret_s, expr_t *ex
     case EXPR_KIND_OPERATOR1: {
       expr_operator1_t *k = expr->k.operator1;
       assert(!k->op.sign); // not sure what this would mean...
-      s += value_str(&k->dest, true);
-      s += std::format<" %s ;">(k->op);
+      value_str(s, d->symbols, &k->dest, true);
+      std::format_to<" %s ;">(std::back_inserter(s), k->op.oper);
     } break;
     case EXPR_KIND_OPERATOR2: {
       expr_operator2_t *k = expr->k.operator2;
       if (k->op.sign)
         s += "(int16_t)";
-      s += value_str(&k->dest, true);
-      s += std::format<" %s ">(k->op);
+      value_str(s, d->symbols, &k->dest, true);
+      std::format_to<" %s ">(std::back_inserter(s), k->op.oper);
       if (k->op.sign)
         s += "(int16_t)";
-      s += value_str(&k->src, false) + ";";
+      value_str(s, d->symbols, &k->src, false);
+      s += ";";
     } break;
     case EXPR_KIND_OPERATOR3: {
       expr_operator3_t *k = expr->k.operator3;
-      s += value_str(&k->dest, true) + " = ";
+      value_str(s, d->symbols, &k->dest, true);
+      s += " = ";
       if (k->op.sign)
         s += "(int16_t)";
-      s += value_str(&k->left, false);
-      s += std::format<" %s ">(k->op);
+      value_str(s, d->symbols, &k->left, false);
+      std::format_to<" %s ">(std::back_inserter(s), k->op.oper);
 
       if (k->op.sign)
         s += "(int16_t)";
-      s += value_str(&k->right, false) + ";";
+      value_str(s, d->symbols, &k->right, false);
+      s += ";";
+    } break;
+    case EXPR_KIND_OPERATOR32: {
+      expr_operator32_t *k = expr->k.operator32;
+      bool is_mul    = 0 == strcmp(k->op.oper, "*");
+      bool is_assign = 0 == strcmp(k->op.oper, "=");
+
+      str_t rhs(s.get_allocator());
+      if (is_mul) {
+        rhs += k->op.sign ? "(int32_t)(int16_t)" : "(uint32_t)";
+        value_str(rhs, d->symbols, &k->left[0], false);
+        rhs += k->op.sign ? " * (int16_t)" : " * ";
+        value_str(rhs, d->symbols, &k->right[0], false);
+      } else if (is_assign) {
+        value32_str(rhs, d->symbols, k->left, false);
+      } else {
+        value32_str(rhs, d->symbols, k->left, false);
+        std::format_to<" %s ">(std::back_inserter(rhs), k->op.oper);
+        value32_str(rhs, d->symbols, k->right, false);
+      }
+
+      if (value32_str(s, d->symbols, k->dest, true)) {
+        if (is_mul || is_assign) {
+          s += " = ";
+          s += rhs;
+        } else {
+          // left is dest
+          std::format_to<" %s= ">(std::back_inserter(s), k->op.oper);
+          value32_str(s, d->symbols, k->right, false);
+        }
+        s += ";";
+      } else {
+        // Halves that don't make one lvalue (DX:AX) are assigned separately
+        s += "{ uint32_t r32 = ";
+        s += rhs;
+        s += "; ";
+        value_str(s, d->symbols, &k->dest[1], true);
+        s += " = r32 >> 16; ";
+        value_str(s, d->symbols, &k->dest[0], true);
+        s += " = (uint16_t)r32; }";
+      }
     } break;
     case EXPR_KIND_ABSTRACT: {
       expr_abstract_t *k = expr->k.abstract;
       if (!VALUE_IS_NONE(k->ret)) {
-        s += value_str(&k->ret, true) + " = ";
+        value_str(s, d->symbols, &k->ret, true);
+        s += " = ";
       }
       s += k->func_name;
       s += "(";
       for (size_t i = 0; i < k->n_args; i++) {
         if (i)
           s += ", ";
-        s += value_str(&k->args[i], false);
+        value_str(s, d->symbols, &k->args[i], false);
       }
       s += ");";
     } break;
@@ -343,33 +603,34 @@ static void decompiler_emit_expr(decompiler_t *d, std::string& ret_s, expr_t *ex
       s += "if (";
       if (k->op.sign)
         s += "(int16_t)";
-      s += value_str(&k->left, false);
-      s += std::format<" %s ">(k->op);
+      value_str(s, d->symbols, &k->left, false);
+      std::format_to<" %s ">(std::back_inserter(s), k->op.oper);
       if (k->op.sign)
         s += "(int16_t)";
-      s += std::format<") goto label_%08x;">(k->target);
+      value_str(s, d->symbols, &k->right, false);
+      std::format_to<") goto label_%08x;">(std::back_inserter(s), k->target);
     } break;
     case EXPR_KIND_BRANCH_FLAGS: {
       expr_branch_flags_t *k = expr->k.branch_flags;
-      s += std::format<"if (%s(">(k->op);
-      s += value_str(&k->flags, false);
-      s += std::format<")) goto label_%08x;">(k->target);
+      std::format_to<"if (%s(">(std::back_inserter(s), k->op);
+      value_str(s, d->symbols, &k->flags, false);
+      std::format_to<")) goto label_%08x;">(std::back_inserter(s), k->target);
     } break;
     case EXPR_KIND_BRANCH: {
       expr_branch_t *k = expr->k.branch;
-      s += std::format<"goto label_%08x;">(k->target);
+      std::format_to<"goto label_%08x;">(std::back_inserter(s), k->target);
     } break;
     case EXPR_KIND_CALL: {
       expr_call_t *k = expr->k.call;
       if (k->func) {
-        s += std::format<"CALL_FUNC(%s);">(k->func->name);
+        std::format_to<"CALL_FUNC(%s);">(std::back_inserter(s), k->func->name);
       } else {
         switch (k->addr.type) {
           case addr_type_e::ADDR_TYPE_FAR: {
-              s += std::format<"CALL_FAR(0x%04x, 0x%04x);">(k->addr.u.far.seg, k->addr.u.far.off);
+              std::format_to<"CALL_FAR(0x%04x, 0x%04x);">(std::back_inserter(s), k->addr.u.far.seg, k->addr.u.far.off);
           } break;
           case addr_type_e::ADDR_TYPE_NEAR: {
-              s += std::format<"CALL_NEAR(0x%04x);">(k->addr.u.near);
+              std::format_to<"CALL_NEAR(0x%04x);">(std::back_inserter(s), k->addr.u.near);
           } break;
           default: {
               FAIL("Unknonw address type: %d", int(k->addr.type));
@@ -381,9 +642,10 @@ static void decompiler_emit_expr(decompiler_t *d, std::string& ret_s, expr_t *ex
     } break;
     case EXPR_KIND_CALL_WITH_ARGS: {
       expr_call_with_args_t *k = expr->k.call_with_args;
-      s += std::format<"%s(m">(k->func->name);
+      std::format_to<"%s(m">(std::back_inserter(s), k->func->name);
       for (size_t i = 0; i < (size_t)k->func->args; i++) {
-        s += ", " + value_str(&k->args[i], false);
+        s += ", ";
+        value_str(s, d->symbols, &k->args[i], false);
       }
       s += ");";
       if (k->remapped)
@@ -397,8 +659,8 @@ static void decompiler_emit_expr(decompiler_t *d, std::string& ret_s, expr_t *ex
   for (size_t i = 0; i < expr->n_ins; i++)
   {
     std::string as = dis86_print_intel_syntax(d->dis, &expr->ins[i], false);
-    std::string cs = i+1 == expr->n_ins ? s : "";
-    ret_s += std::format<"  %-50s // %s\n">(cs, as);
+    std::string_view cs = i+1 == expr->n_ins ? std::string_view(s) : std::string_view();
+    std::format_to<"  %-50s // %s\n">(std::back_inserter(ret_s), cs, as);
   }
 }
 
@@ -409,20 +671,91 @@ std::string dis86_decompile( dis86_t *                  dis,
                        dis86_instr_t *            ins_arr,
                        size_t                     n_ins )
 {
-  std::string s;
+  uint64_t t0 = STAT_NOW();
+
+  arena_t *arena = session_arena();
+  arena_reset(arena);
+  arena_resource resource(arena);
+  str_t s(&resource);
+
+  // Duplicated functions (e.g. runtime routines linked into several overlays)
+  // reuse the analysis of the first copy
+  memo_t *memo = nullptr;
+  memo_key_t key;
+  symbols_t *shared = nullptr;
+  meh_t *meh = nullptr;
+  if (opt_cfg) {
+    PHASE("memo");
+    if (!opt_cfg->memo) opt_cfg->memo = memo_new();
+    memo = opt_cfg->memo;
+    memo_key_init(&key, dis, opt_cfg, seg, ins_arr, n_ins);
+    meh = memo_lookup(memo, &key, ins_arr, &shared, arena);
+    if (meh) STAT_INC(MEMO_HIT);
+    else     STAT_INC(MEMO_MISS);
+  }
 
-  decompiler_t *d = decompiler_new(dis, opt_cfg, func_name, seg, ins_arr, n_ins);
-  decompiler_initial_analysis(d);
-  decompiler_emit_preamble(d, s);
+  decompiler_t *d = decompiler_new(arena, dis, opt_cfg, func_name, seg, ins_arr, n_ins);
+  if (meh) {
+    d->symbols = shared;
+    d->meh = meh;
+  }
+
+  // FAIL throws under dis86_decompile_checked: don't leak the analysis
+  try {
+    if (meh) find_labels(d->labels, d->ins, d->n_ins);
+    else     decompiler_initial_analysis(d);
+
+    PHASE("emit");
+    d->escape = escape_new(d->meh, d->symbols, d->arena);
+    decompiler_emit_preamble(d, s);
 
-  for (size_t i = 0; i < d->meh->expr_len; i++) {
-    expr_t *expr = &d->meh->expr_arr[i];
-    if (expr->n_ins > 0 && is_label(d->labels, (uint32_t)expr->ins->addr)) {
-      s += std::format<"\n label_%08x:\n">((uint32_t)expr->ins->addr);
+    for (size_t i = 0; i < d->meh->expr_len; i++) {
+      expr_t *expr = &d->meh->expr_arr[i];
+      if (expr->n_ins > 0 && is_label(d->labels, (uint32_t)expr->ins->addr)) {
+        std::format_to<"\n label_%08x:\n">(std::back_inserter(s), (uint32_t)expr->ins->addr);
+      }
+      decompiler_emit_expr(d, s, expr);
+
+      const dis86_instr_t *setup = d->escape->frame_setup;
+      if (setup && setup >= expr->ins && setup < expr->ins + expr->n_ins) decompiler_emit_param_loads(d, s);
     }
-    decompiler_emit_expr(d, s, expr);
+
+    decompiler_emit_postamble(d, s);
+  } catch (...) {
+    if (shared) d->symbols = nullptr; // still owned by the memo
+    decompiler_delete(d);
+    throw;
   }
 
-  decompiler_emit_postamble(d, s);
-  return s;
+  if (shared)    d->symbols = nullptr; // owned by the memo
+  else if (memo) memo_insert(memo, &key, d->ins, d->n_ins, d->symbols, d->meh);
+  decompiler_delete(d);
+
+  STAT_INC(FUNCS_DECOMPILED);
+  STAT_ADD(EMIT_BYTES, s.size());
+  STAT_FUNCTION(func_name, n_ins, STAT_NOW() - t0);
+  return std::string(s);
+}
+
+dis86_status_t dis86_decompile_checked( dis86_t *                  dis,
+                                        dis86_decompile_config_t * opt_cfg,
+                                        const char *               func_name,
+                                        uint16_t                   seg,
+                                        dis86_instr_t *            ins_arr,
+                                        size_t                     n_ins,
+                                        std::string *              out,
+                                        dis86_error_t *            err )
+{
+  try {
+    fail_recover recover;
+    *out = dis86_decompile(dis, opt_cfg, func_name, seg, ins_arr, n_ins);
+    return DIS86_OK;
+  } catch (const fail_error& e) {
+    out->clear();
+    if (err) {
+      err->addr = n_ins ? ins_arr[0].addr : 0;
+      snprintf(err->msg, sizeof(err->msg), "%s", e.msg);
+    }
+    return DIS86_ERROR;
+  }
 }
@@ -1,12 +1,23 @@
 #pragma once
 #include "header.h"
 #include "dis86.h"
+#include "common/stats.h"
+#include "common/fail.h"
+#include "common/arena.h"
 #include "symbols.h"
 #include "config.h"
 #include "labels.h"
+#include "cfg.h"
+#include "dom.h"
 #include "type.h"
 #include "value.h"
 #include "expr.h"
+#include "ssa.h"
+#include "flags.h"
+#include "liveness.h"
+#include "escape.h"
+#include "memo.h"
+#include "signature.h"
 #include "transform.h"
 
 #define LOG_INFO(fmt, ...) do { \
@@ -0,0 +1,333 @@
+#include "decompile_private.h"
+
+static void dom_release(dom_t *dom)
+{
+  free(dom->rpo);
+  free(dom->rpo_index);
+  free(dom->idom);
+  free(dom->child_off);
+  free(dom->child);
+  free(dom->pre);
+  free(dom->post);
+  free(dom->loops);
+  free(dom->loop_of);
+  memset(dom, 0, sizeof(*dom));
+}
+
+dom_t * dom_new(void)
+{
+  return (dom_t*)calloc(1, sizeof(dom_t));
+}
+
+void dom_delete(dom_t *dom)
+{
+  dom_release(dom);
+  free(dom);
+}
+
+// Iterative DFS from the entry. Produces the reverse postorder that dataflow
+// passes iterate in, plus the preorder numbering and DFS-tree parents that
+// Lengauer-Tarjan needs.
+static void compute_dfs(dom_t *dom, const cfg_t *cfg, uint32_t *vertex, uint32_t *parent)
+{
+  uint32_t n = cfg->n_blocks;
+  dom->rpo       = (uint32_t*)malloc((n ? n : 1) * sizeof(uint32_t));
+  dom->rpo_index = (uint32_t*)malloc((n ? n : 1) * sizeof(uint32_t));
+  for (uint32_t b = 0; b < n; b++) dom->rpo_index[b] = CFG_NONE;
+  if (!n) return;
+
+  // The stack holds blocks whose successors are still being walked; cursor
+  // counts how many have been looked at. Postorder is reversed at the end.
+  uint32_t *stack  = (uint32_t*)malloc(n * sizeof(uint32_t));
+  uint32_t *cursor = (uint32_t*)calloc(n, sizeof(uint32_t));
+  uint8_t  *seen   = (uint8_t*)calloc(n, 1);
+  uint32_t  sp = 0, n_pre = 0, n_post = 0;
+
+  stack[sp++] = 0;
+  seen[0] = 1;
+  vertex[n_pre++] = 0;
+  parent[0] = CFG_NONE;
+  while (sp) {
+    uint32_t b = stack[sp-1];
+    if (cursor[b] < cfg_n_succ(cfg, b)) {
+      uint32_t s = cfg_succ(cfg, b)[cursor[b]++];
+      if (!seen[s]) {
+        seen[s] = 1;
+        parent[s] = b;
+        vertex[n_pre++] = s;
+        stack[sp++] = s;
+      }
+      continue;
+    }
+    sp--;
+    dom->rpo[n_post++] = b;
+  }
+
+  dom->n_rpo = n_post;
+  for (uint32_t i = 0; i < n_post/2; i++) {
+    uint32_t tmp = dom->rpo[i];
+    dom->rpo[i] = dom->rpo[n_post-1-i];
+    dom->rpo[n_post-1-i] = tmp;
+  }
+  for (uint32_t i = 0; i < n_post; i++) dom->rpo_index[dom->rpo[i]] = i;
+
+  free(stack);
+  free(cursor);
+  free(seen);
+}
+
+// Lengauer-Tarjan, "simple" variant: path compression without balancing, so
+// O(m log n). Vertices are handled by preorder number; semi[] holds preorder
+// numbers as well.
+typedef struct lt_state lt_state_t;
+struct lt_state
+{
+  uint32_t *semi;
+  uint32_t *ancestor;
+  uint32_t *label;
+  uint32_t *path;    /* scratch for compress() */
+};
+
+static void lt_compress(lt_state_t *lt, uint32_t v)
+{
+  // Equivalent to the textbook recursion, unrolled so deep DFS trees can't
+  // overflow the stack: update from the node nearest the root downwards
+  uint32_t n = 0;
+  for (uint32_t x = v; lt->ancestor[lt->ancestor[x]] != CFG_NONE; x = lt->ancestor[x]) {
+    lt->path[n++] = x;
+  }
+  while (n) {
+    uint32_t x = lt->path[--n];
+    uint32_t a = lt->ancestor[x];
+    if (lt->semi[lt->label[a]] < lt->semi[lt->label[x]]) lt->label[x] = lt->label[a];
+    lt->ancestor[x] = lt->ancestor[a];
+  }
+}
+
+static uint32_t lt_eval(lt_state_t *lt, uint32_t v)
+{
+  if (lt->ancestor[v] == CFG_NONE) return v;
+  lt_compress(lt, v);
+  return lt->label[v];
+}
+
+static void compute_idom(dom_t *dom, const cfg_t *cfg, uint32_t *vertex, uint32_t *parent)
+{
+  uint32_t n = cfg->n_blocks;
+  dom->idom = (uint32_t*)malloc((n ? n : 1) * sizeof(uint32_t));
+  for (uint32_t b = 0; b < n; b++) dom->idom[b] = CFG_NONE;
+  if (!n) return;
+
+  uint32_t n_reach = dom->n_rpo;
+  lt_state_t lt[1];
+  lt->semi     = (uint32_t*)malloc(n * sizeof(uint32_t));
+  lt->ancestor = (uint32_t*)malloc(n * sizeof(uint32_t));
+  lt->label    = (uint32_t*)malloc(n * sizeof(uint32_t));
+  lt->path     = (uint32_t*)malloc(n * sizeof(uint32_t));
+
+  // Buckets are singly linked lists threaded through bucket_next
+  uint32_t *bucket      = (uint32_t*)malloc(n * sizeof(uint32_t));
+  uint32_t *bucket_next = (uint32_t*)malloc(n * sizeof(uint32_t));
+
+  for (uint32_t b = 0; b < n; b++) {
+    lt->semi[b]     = CFG_NONE;
+    lt->ancestor[b] = CFG_NONE;
+    lt->label[b]    = b;
+    bucket[b]       = CFG_NONE;
+  }
+  for (uint32_t i = 0; i < n_reach; i++) lt->semi[vertex[i]] = i;
+
+  for (uint32_t i = n_reach; i-- > 1; ) {
+    uint32_t w = vertex[i];
+    uint32_t p = parent[w];
+
+    for (size_t j = 0; j < cfg_n_pred(cfg, w); j++) {
+      uint32_t v = cfg_pred(cfg, w)[j];
+      if (!dom_reachable(dom, v)) continue;
+      uint32_t u = lt_eval(lt, v);
+      if (lt->semi[u] < lt->semi[w]) lt->semi[w] = lt->semi[u];
+    }
+
+    uint32_t sw = vertex[lt->semi[w]];
+    bucket_next[w] = bucket[sw];
+    bucket[sw] = w;
+    lt->ancestor[w] = p;
+
+    for (uint32_t v = bucket[p]; v != CFG_NONE; v = bucket_next[v]) {
+      uint32_t u = lt_eval(lt, v);
+      dom->idom[v] = lt->semi[u] < lt->semi[v] ? u : p;
+    }
+    bucket[p] = CFG_NONE;
+  }
+
+  for (uint32_t i = 1; i < n_reach; i++) {
+    uint32_t w = vertex[i];
+    if (dom->idom[w] != vertex[lt->semi[w]]) dom->idom[w] = dom->idom[dom->idom[w]];
+  }
+  dom->idom[0] = 0;
+
+  free(lt->semi);
+  free(lt->ancestor);
+  free(lt->label);
+  free(lt->path);
+  free(bucket);
+  free(bucket_next);
+}
+
+// Children lists plus pre/post numbering of the dominator tree. Also returns
+// the tree's postorder, which the loop pass walks.
+static uint32_t * compute_tree(dom_t *dom, const cfg_t *cfg)
+{
+  uint32_t n = cfg->n_blocks;
+  dom->child_off = (uint32_t*)calloc(n+1, sizeof(uint32_t));
+  dom->child     = (uint32_t*)malloc((n ? n : 1) * sizeof(uint32_t));
+  dom->pre       = (uint32_t*)malloc((n ? n : 1) * sizeof(uint32_t));
+  dom->post      = (uint32_t*)malloc((n ? n : 1) * sizeof(uint32_t));
+  uint32_t *order = (uint32_t*)malloc((n ? n : 1) * sizeof(uint32_t));
+  if (!n) return order;
+
+  for (uint32_t b = 1; b < n; b++) {
+    if (dom->idom[b] != CFG_NONE) dom->child_off[dom->idom[b]+1]++;
+  }
+  for (uint32_t b = 0; b < n; b++) dom->child_off[b+1] += dom->child_off[b];
+
+  uint32_t *cursor = (uint32_t*)malloc(n * sizeof(uint32_t));
+  memcpy(cursor, dom->child_off, n * sizeof(uint32_t));
+  for (uint32_t b = 1; b < n; b++) {
+    if (dom->idom[b] != CFG_NONE) dom->child[cursor[dom->idom[b]]++] = b;
+  }
+
+  uint32_t *stack = (uint32_t*)malloc(n * sizeof(uint32_t));
+  memcpy(cursor, dom->child_off, n * sizeof(uint32_t));
+  uint32_t sp = 0, n_pre = 0, n_post = 0;
+  stack[sp++] = 0;
+  dom->pre[0] = n_pre++;
+  while (sp) {
+    uint32_t b = stack[sp-1];
+    if (cursor[b] < dom->child_off[b+1]) {
+      uint32_t c = dom->child[cursor[b]++];
+      dom->pre[c] = n_pre++;
+      stack[sp++] = c;
+      continue;
+    }
+    sp--;
+    dom->post[b] = n_post;
+    order[n_post++] = b;
+  }
+
+  free(stack);
+  free(cursor);
+  return order;
+}
+
+static void compute_loops(dom_t *dom, const cfg_t *cfg, uint32_t *tree_post)
+{
+  uint32_t n = cfg->n_blocks;
+  dom->loop_of = (uint32_t*)malloc((n ? n : 1) * sizeof(uint32_t));
+  dom->loops   = (dom_loop_t*)malloc((n ? n : 1) * sizeof(dom_loop_t));
+  for (uint32_t b = 0; b < n; b++) dom->loop_of[b] = CFG_NONE;
+  if (!n) return;
+
+  // Shared worklist: every block is pushed at most once per enclosing loop
+  // header it gets collapsed into, so total work stays near-linear.
+  uint32_t *work = (uint32_t*)malloc((cfg->pred_off[n] + 1) * sizeof(uint32_t));
+
+  // Union-find over loops pointing at the outermost loop found so far, so
+  // deep nests don't walk the whole parent chain every time
+  uint32_t *outer = (uint32_t*)malloc(n * sizeof(uint32_t));
+
+  for (uint32_t i = 0; i < dom->n_rpo; i++) {
+    uint32_t h = tree_post[i];
+
+    uint32_t sp = 0;
+    for (size_t j = 0; j < cfg_n_pred(cfg, h); j++) {
+      uint32_t p = cfg_pred(cfg, h)[j];
+      if (dom_dominates(dom, h, p)) work[sp++] = p;
+    }
+    if (!sp) continue;
+
+    uint32_t l = dom->n_loops++;
+    dom->loops[l].header   = h;
+    dom->loops[l].parent   = CFG_NONE;
+    dom->loops[l].depth    = 0;
+    dom->loops[l].n_blocks = 0;
+    dom->loop_of[h] = l;
+    outer[l] = l;
+
+    while (sp) {
+      uint32_t b = work[--sp];
+      if (!dom_reachable(dom, b)) continue;
+
+      uint32_t expand;
+      if (dom->loop_of[b] == CFG_NONE) {
+        dom->loop_of[b] = l;
+        expand = b;
+      } else {
+        // Already inside some loop: hop to its outermost enclosing loop and
+        // continue from that loop's header
+        uint32_t sub = dom->loop_of[b];
+        while (outer[sub] != sub) {
+          outer[sub] = outer[outer[sub]];
+          sub = outer[sub];
+        }
+        if (sub == l) continue;
+        dom->loops[sub].parent = l;
+        outer[sub] = l;
+        expand = dom->loops[sub].header;
+      }
+
+      for (size_t j = 0; j < cfg_n_pred(cfg, expand); j++) {
+        work[sp++] = cfg_pred(cfg, expand)[j];
+      }
+    }
+  }
+  free(work);
+  free(outer);
+
+  // Parents are always discovered after their children
+  for (uint32_t b = 0; b < n; b++) {
+    if (dom->loop_of[b] != CFG_NONE) dom->loops[dom->loop_of[b]].n_blocks++;
+  }
+  for (uint32_t l = 0; l < dom->n_loops; l++) {
+    uint32_t p = dom->loops[l].parent;
+    if (p != CFG_NONE) dom->loops[p].n_blocks += dom->loops[l].n_blocks;
+  }
+  for (uint32_t l = dom->n_loops; l-- > 0; ) {
+    uint32_t p = dom->loops[l].parent;
+    dom->loops[l].depth = p == CFG_NONE ? 1 : dom->loops[p].depth + 1;
+  }
+}
+
+bool dom_update(dom_t *dom, const cfg_t *cfg)
+{
+  if (dom->cfg_version == cfg->version) return false;
+
+  dom_release(dom);
+  dom->cfg_version = cfg->version;
+  dom->n_blocks    = cfg->n_blocks;
+
+  uint32_t n = cfg->n_blocks ? cfg->n_blocks : 1;
+  uint32_t *vertex = (uint32_t*)malloc(n * sizeof(uint32_t));
+  uint32_t *parent = (uint32_t*)malloc(n * sizeof(uint32_t));
+  compute_dfs(dom, cfg, vertex, parent);
+  compute_idom(dom, cfg, vertex, parent);
+  free(vertex);
+  free(parent);
+
+  uint32_t *tree_post = compute_tree(dom, cfg);
+  compute_loops(dom, cfg, tree_post);
+  free(tree_post);
+  return true;
+}
+
+void dom_dump(dom_t *dom)
+{
+  for (uint32_t b = 0; b < dom->n_blocks; b++) {
+    if (!dom_reachable(dom, b)) {
+      fprintf(stderr, "  block %-5u | unreachable\n", b);
+      continue;
+    }
+    fprintf(stderr, "  block %-5u | idom %-5u | loop depth %u%s\n",
+            b, dom->idom[b], dom_loop_depth(dom, b), dom_is_loop_header(dom, b) ? " (header)" : "");
+  }
+}
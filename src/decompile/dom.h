@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <unistd.h>
+
+#include "cfg.h"
+
+// Dominator tree and natural-loop forest over a cfg_t
+//
+// Immediate dominators are computed with Lengauer-Tarjan (path compression,
+// O(m log n)) rather than the simpler iterative Cooper-Harvey-Kennedy scheme,
+// which degrades to quadratic on deeply nested loops. The tree is then
+// numbered with pre/post indices so that "a dominates b" is an O(1) check.
+//
+// Loops are natural loops: a header plus every block that reaches one of its
+// latches (a predecessor the header dominates) without passing through the
+// header. Headers are visited innermost first and already-discovered loops are
+// collapsed to their header while walking, so nesting is found in one pass.
+// Retreating edges into a block that does not dominate the source
+// (irreducible flow) are not reported as loops.
+//
+// Results are tied to the cfg version they were computed from: dom_update()
+// is free when the graph hasn't changed.
+
+typedef struct dom_loop dom_loop_t;
+struct dom_loop
+{
+  uint32_t header;
+  uint32_t parent;     /* enclosing loop, or CFG_NONE */
+  uint32_t depth;      /* 1 for outermost loops */
+  uint32_t n_blocks;   /* including nested loops */
+};
+
+typedef struct dom dom_t;
+struct dom
+{
+  uint32_t     cfg_version;  /* 0 until the first update */
+  uint32_t     n_blocks;
+
+  uint32_t     n_rpo;
+  uint32_t *   rpo;          /* reachable blocks in reverse postorder */
+  uint32_t *   rpo_index;    /* block -> position in rpo, CFG_NONE if unreachable */
+
+  uint32_t *   idom;         /* entry is its own idom, unreachable blocks have CFG_NONE */
+  uint32_t *   child_off;    /* dominator tree children, CSR like the cfg edges */
+  uint32_t *   child;
+  uint32_t *   pre;          /* dominator tree pre/post numbering */
+  uint32_t *   post;
+
+  uint32_t     n_loops;
+  dom_loop_t * loops;        /* inner loops always come before their parents */
+  uint32_t *   loop_of;      /* block -> innermost loop, CFG_NONE if none */
+};
+
+dom_t * dom_new(void);
+void    dom_delete(dom_t *dom);
+bool    dom_update(dom_t *dom, const cfg_t *cfg);   /* returns true if it had to recompute */
+void    dom_dump(dom_t *dom);
+
+static inline bool dom_reachable(const dom_t *dom, uint32_t b)
+{
+  return dom->rpo_index[b] != CFG_NONE;
+}
+
+static inline bool dom_dominates(const dom_t *dom, uint32_t a, uint32_t b)
+{
+  if (!dom_reachable(dom, a) || !dom_reachable(dom, b)) return false;
+  return dom->pre[a] <= dom->pre[b] && dom->post[b] <= dom->post[a];
+}
+
+static inline uint32_t dom_loop_depth(const dom_t *dom, uint32_t b)
+{
+  uint32_t l = dom->loop_of[b];
+  return l == CFG_NONE ? 0 : dom->loops[l].depth;
+}
+
+static inline bool dom_is_loop_header(const dom_t *dom, uint32_t b)
+{
+  uint32_t l = dom->loop_of[b];
+  return l != CFG_NONE && dom->loops[l].header == b;
+}
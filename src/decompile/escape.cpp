@@ -0,0 +1,126 @@
+#include "decompile_private.h"
+
+static void escape_all(escape_t *e)
+{
+  memset(e->params, 0, e->n_params);
+  memset(e->locals, 0, e->n_locals);
+}
+
+static void escape_sym(escape_t *e, sym_id_t id)
+{
+  switch (SYM_ID_KIND(id)) {
+    case SYM_KIND_PARAM: e->params[SYM_ID_INDEX(id)] = 0; break;
+    case SYM_KIND_LOCAL: e->locals[SYM_ID_INDEX(id)] = 0; break;
+    default: break;
+  }
+}
+
+// Every slot reaching at or above BP+off: from a local that is the rest of
+// the locals, the saved BP and return address and all of the params
+static void escape_from(escape_t *e, const symbols_t *symbols, int16_t off)
+{
+  for (size_t i = 0; i < e->n_params; i++) {
+    if (symbols->params->var[i].off + symbols->params->var[i].len > off) e->params[i] = 0;
+  }
+  for (size_t i = 0; i < e->n_locals; i++) {
+    if (symbols->locals->var[i].off + symbols->locals->var[i].len > off) e->locals[i] = 0;
+  }
+}
+
+static bool is_reg(const operand_t *o, int reg_id)
+{
+  return o->type == OPERAND_TYPE_REG && o->u.reg.id == reg_id;
+}
+
+static bool is_frame_reg(const operand_t *o)
+{
+  return is_reg(o, REG_BP) || is_reg(o, REG_SP);
+}
+
+// push bp / mov bp,sp / mov sp,bp / sub sp,n and the like: the frame
+// pointers only move between themselves. Past the prologue a push of BP
+// hands the frame address out like any other copy.
+static bool frame_bookkeeping(const escape_t *e, dis86_instr_t *ins)
+{
+  if (ins->opcode == operation_e::PUSH) return !e->frame_setup;
+  return is_frame_reg(&ins->operand[0]) &&
+    (ins->operand[1].type != OPERAND_TYPE_REG || is_frame_reg(&ins->operand[1]));
+}
+
+static void escape_instr(escape_t *e, symbols_t *symbols, dis86_instr_t *ins, bool unknown)
+{
+  const instr_regs_t& r = instr_regs[size_t(ins->opcode)];
+  for (size_t i = 0; i < ARRAY_SIZE(ins->operand); i++) {
+    operand_t *o = &ins->operand[i];
+    if (o->type == OPERAND_TYPE_REG) {
+      if (is_frame_reg(o) && (r.read & (1<<i)) && !frame_bookkeeping(e, ins)) escape_all(e);
+      continue;
+    }
+    if (o->type != OPERAND_TYPE_MEM) continue;
+
+    operand_mem_t *mem = &o->u.mem;
+    if (mem->reg1 != REG_BP && mem->reg2 != REG_BP) continue;
+    if (!e->frame_setup) escape_all(e);
+
+    sym_t deduced[1];
+    symref_t ref = {};
+    if (ins->opcode != operation_e::LEA && sym_deduce(deduced, mem)) ref = symbols_find_ref(symbols, deduced);
+    if (ref.id == SYM_ID_NONE) {
+      escape_from(e, symbols, (int16_t)mem->off);
+      continue;
+    }
+
+    const sym_t *sym = symbols_sym(symbols, ref.id);
+    if (unknown || ref.off != 0 || ref.len != sym->len) escape_sym(e, ref.id);
+  }
+}
+
+// A 32-bit value made of two different slots is accessed through the
+// address of the low one
+static void escape_pair(escape_t *e, value_t v[2])
+{
+  if (v[0].type != VALUE_TYPE_SYM || v[1].type != VALUE_TYPE_SYM) return;
+  if (v[0].u.sym->ref.id == v[1].u.sym->ref.id) return;
+  escape_sym(e, v[0].u.sym->ref.id);
+  escape_sym(e, v[1].u.sym->ref.id);
+}
+
+static bool has_c_type(const sym_t *sym)
+{
+  return sym->len == 1 || sym->len == 2 || sym->len == 4;
+}
+
+escape_t * escape_new(meh_t *m, symbols_t *symbols, arena_t *arena)
+{
+  escape_t *e = arena_calloc<escape_t>(arena, 1);
+  e->n_params = symbols->params->n_var;
+  e->n_locals = symbols->locals->n_var;
+  e->params   = arena_calloc<uint8_t>(arena, e->n_params ? e->n_params : 1);
+  e->locals   = arena_calloc<uint8_t>(arena, e->n_locals ? e->n_locals : 1);
+
+  for (size_t i = 0; i < e->n_params; i++) e->params[i] = has_c_type(&symbols->params->var[i]);
+  for (size_t i = 0; i < e->n_locals; i++) e->locals[i] = has_c_type(&symbols->locals->var[i]);
+
+  size_t n_frames = 0;
+  for (size_t i = 0; i < m->expr_len; i++) {
+    expr_t *expr = &m->expr_arr[i];
+    for (size_t j = 0; j < expr->n_ins; j++) {
+      dis86_instr_t *ins = &expr->ins[j];
+      if (ins->opcode == operation_e::ENTER ||
+          (ins->opcode == operation_e::MOV && is_reg(&ins->operand[0], REG_BP) && is_reg(&ins->operand[1], REG_SP))) {
+        if (!e->frame_setup) e->frame_setup = ins;
+        n_frames++;
+      }
+      escape_instr(e, symbols, ins, expr->kind == EXPR_KIND_UNKNOWN);
+    }
+    if (expr->kind == EXPR_KIND_OPERATOR32) {
+      expr_operator32_t *k = expr->k.operator32;
+      escape_pair(e, k->dest);
+      escape_pair(e, k->left);
+      escape_pair(e, k->right);
+    }
+  }
+  if (n_frames != 1) escape_all(e);
+
+  return e;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <unistd.h>
+
+#include "expr.h"
+#include "symbols.h"
+
+// Stack slots that can be plain C variables
+//
+// A param or local is emitted as a real variable instead of a macro over the
+// emulated stack when nothing can reach it other than its own name:
+//   - its address is never taken: no lea of it, and no indexed or
+//     segment-overridden access through BP that could land on it. A C
+//     object extends upwards from its address, so these give away every
+//     slot from that offset up: the address of a local reaches the params
+//   - every access covers exactly the whole slot (no overlapping or partial
+//     accesses, no 32-bit accesses spanning two slots)
+//   - no unknown instruction touches it
+// Everything escapes unless the function sets up its own frame exactly once
+// and ahead of any access through BP, or if BP or SP are read as values
+// anywhere but the frame setup and teardown (the address of the frame could
+// end up anywhere). Params are loaded from the frame once it is set up.
+
+typedef struct escape escape_t;
+struct escape
+{
+  size_t    n_params;
+  size_t    n_locals;
+  uint8_t * params;   /* per params symtab index: 1 if it can be a variable */
+  uint8_t * locals;   /* per locals symtab index: 1 if it can be a variable */
+
+  const dis86_instr_t * frame_setup;  /* mov bp,sp or enter: BP is valid after it */
+};
+
+/* Carved from the arena: goes when it is reset */
+escape_t * escape_new(meh_t *m, symbols_t *symbols, arena_t *arena);
+
+static inline bool escape_promoted(const escape_t *e, const symbols_t *symbols, const sym_t *var)
+{
+  if (var->kind == SYM_KIND_PARAM) return e->params[var - symbols->params->var];
+  if (var->kind == SYM_KIND_LOCAL) return e->locals[var - symbols->locals->var];
+  return false;
+}
@@ -57,7 +57,7 @@ static size_t _impl_abstract(expr_t *expr, symbols_t *symbols, dis86_instr_t *in
   k->ret = VALUE_NONE;
   k->n_args = 0;
 
-  assert(ARRAY_SIZE(k->args) <= ARRAY_SIZE(ins->operand));
+  assert(ARRAY_SIZE(k->args) >= ARRAY_SIZE(ins->operand));
   for (size_t i = 0; i < ARRAY_SIZE(ins->operand); i++) {
     operand_t *o = &ins->operand[i];
     if (o->type == OPERAND_TYPE_NONE) break;
@@ -78,7 +78,7 @@ static size_t _impl_abstract_ret(expr_t *expr, symbols_t *symbols, dis86_instr_t
   k->ret = value_from_operand(&ins->operand[0], symbols);
   k->n_args = 0;
 
-  assert(ARRAY_SIZE(k->args) <= ARRAY_SIZE(ins->operand));
+  assert(ARRAY_SIZE(k->args) >= ARRAY_SIZE(ins->operand));
   for (size_t i = 1; i < ARRAY_SIZE(ins->operand); i++) {
     operand_t *o = &ins->operand[i];
     if (o->type == OPERAND_TYPE_NONE) break;
@@ -97,7 +97,7 @@ static size_t _impl_abstract_flags(expr_t *expr, symbols_t *symbols, dis86_instr
   k->ret = value_from_symref(symbols_find_reg(symbols, REG_FLAGS));
   k->n_args = 0;
 
-  assert(ARRAY_SIZE(k->args) <= ARRAY_SIZE(ins->operand));
+  assert(ARRAY_SIZE(k->args) >= ARRAY_SIZE(ins->operand));
   for (size_t i = 0; i < ARRAY_SIZE(ins->operand); i++) {
     operand_t *o = &ins->operand[i];
     if (o->type == OPERAND_TYPE_NONE) break;
@@ -160,7 +160,8 @@ static size_t _impl_call_near(uint16_t seg, expr_t *expr,
 
   size_t effective = (uint16_t)(ins->addr + ins->n_bytes + ins->operand[0].u.rel.val);
   //printf("effective: 0x%x | seg: 0x%x\n", (uint32_t)effective, seg);
-  assert(16*(size_t)seg <= effective && effective < 16*(size_t)seg + (1<<16));
+  if (!(16*(size_t)seg <= effective && effective < 16*(size_t)seg + (1<<16)))
+    FAIL("Near call target 0x%zx is outside segment 0x%04x", effective, seg);
   uint16_t off = effective - 16*(size_t)seg;
 
   segoff_t addr = {seg, off};
@@ -183,9 +184,8 @@ static size_t _impl_load_effective_addr(expr_t *expr, symbols_t *symbols, dis86_
   assert(ins->operand[1].type == OPERAND_TYPE_MEM);
   operand_mem_t *mem = &ins->operand[1].u.mem;
   assert(mem->sz == SIZE_16);
-  assert(mem->reg1);
-  assert(!mem->reg2);
-  assert(mem->off);
+  if (!mem->reg1 || mem->reg2 || !mem->off)
+    FAIL("Unsupported LEA addressing form at 0x%zx", ins->addr);
 
   expr->kind = EXPR_KIND_OPERATOR3;
   expr_operator3_t *k = expr->k.operator3;
@@ -330,6 +330,7 @@ value_t expr_destination(expr_t *expr)
     case EXPR_KIND_OPERATOR1:     return expr->k.operator1->dest;
     case EXPR_KIND_OPERATOR2:     return expr->k.operator2->dest;
     case EXPR_KIND_OPERATOR3:     return expr->k.operator3->dest;
+    case EXPR_KIND_OPERATOR32:    return VALUE_NONE;
     case EXPR_KIND_ABSTRACT:      return expr->k.abstract->ret;
     case EXPR_KIND_BRANCH_COND:   return VALUE_NONE;
     case EXPR_KIND_BRANCH_FLAGS:  return expr->k.branch_flags->flags;
@@ -339,33 +340,43 @@ value_t expr_destination(expr_t *expr)
   }
 }
 
-meh_t * meh_new(dis86_decompile_config_t *cfg, symbols_t *symbols, uint16_t seg, dis86_instr_t *ins, size_t n_ins)
+meh_t * meh_new(dis86_decompile_config_t *cfg, symbols_t *symbols, uint16_t seg, dis86_instr_t *ins, size_t n_ins,
+                arena_t *opt_arena)
 {
-  meh_t *m = (meh_t*)calloc(1, sizeof(meh_t));
-
-  while (n_ins) {
-    assert(m->expr_len < ARRAY_SIZE(m->expr_arr));
-
-    expr_t *expr = &m->expr_arr[m->expr_len];
-    size_t consumed = extract_expr(seg, expr, cfg, symbols, ins, n_ins);
-    assert(consumed <= n_ins);
-    expr->ins = ins;
-    expr->n_ins = consumed;
-    m->expr_len++;
-
-    ins += consumed;
-    n_ins -= consumed;
+  meh_t *m = nullptr;
+  if (opt_arena) {
+    m = arena_calloc<meh_t>(opt_arena, 1);
+    m->expr_arr = arena_calloc<expr_t>(opt_arena, n_ins);
+    m->arena = opt_arena;
+  } else {
+    m = (meh_t*)calloc(1, sizeof(meh_t));
+    m->expr_arr = (expr_t*)calloc(n_ins ? n_ins : 1, sizeof(expr_t));
   }
 
-  transform_pass_xor_rr(m);
-  transform_pass_cmp_jmp(m);
-  transform_pass_or_jmp(m);
-  transform_pass_synthesize_calls(m);
+  // FAIL throws under dis86_decompile_checked
+  try {
+    while (n_ins) {
+      expr_t *expr = &m->expr_arr[m->expr_len];
+      size_t consumed = extract_expr(seg, expr, cfg, symbols, ins, n_ins);
+      assert(consumed <= n_ins);
+      expr->ins = ins;
+      expr->n_ins = consumed;
+      m->expr_len++;
+
+      ins += consumed;
+      n_ins -= consumed;
+    }
+  } catch (...) {
+    meh_delete(m);
+    throw;
+  }
 
   return m;
 }
 
 void meh_delete(meh_t *m)
 {
+  if (m->arena) return;
+  free(m->expr_arr);
   free(m);
 }
@@ -35,6 +35,7 @@ enum {
   EXPR_KIND_OPERATOR1,
   EXPR_KIND_OPERATOR2,
   EXPR_KIND_OPERATOR3,
+  EXPR_KIND_OPERATOR32,
   EXPR_KIND_ABSTRACT,
   EXPR_KIND_BRANCH_COND,
   EXPR_KIND_BRANCH_FLAGS,
@@ -64,12 +65,23 @@ struct expr_operator3_t
   value_t      right;
 };
 
+// 32-bit operation on 16-bit halves (DX:AX and the like): [0] is the low
+// word and [1] the high word, VALUE_NONE if there isn't one (the low word
+// stands for the whole value). 'right' is unused by "=".
+struct expr_operator32_t
+{
+  operator_t   op;
+  value_t      dest[2];
+  value_t      left[2];
+  value_t      right[2];
+};
+
 struct expr_abstract_t
 {
   const char * func_name;
   value_t      ret;
   uint16_t          n_args;
-  value_t      args[3];
+  value_t      args[5];
 };
 
 struct expr_branch_cond_t
@@ -115,6 +127,7 @@ struct expr_t
     expr_operator1_t      operator1[1];
     expr_operator2_t      operator2[1];
     expr_operator3_t      operator3[1];
+    expr_operator32_t     operator32[1];
     expr_abstract_t       abstract[1];
     expr_branch_cond_t    branch_cond[1];
     expr_branch_flags_t   branch_flags[1];
@@ -134,12 +147,13 @@ value_t expr_destination(expr_t *expr);
   expr.kind = EXPR_KIND_NONE; \
   expr; })
 
-#define EXPR_MAX 4096
 struct meh_t
 {
-  size_t expr_len;
-  expr_t expr_arr[EXPR_MAX];
+  size_t    expr_len;
+  expr_t *  expr_arr;  /* room for one expr per instruction */
+  arena_t * arena;     /* holds the above if set: meh_delete() leaves it be */
 };
 
-meh_t * meh_new(dis86_decompile_config_t *cfg, symbols_t *symbols, uint16_t seg, dis86_instr_t *ins, size_t n_ins);
+meh_t * meh_new(dis86_decompile_config_t *cfg, symbols_t *symbols, uint16_t seg, dis86_instr_t *ins, size_t n_ins,
+                arena_t *opt_arena);
 void    meh_delete(meh_t *m);
@@ -0,0 +1,119 @@
+#include "decompile_private.h"
+
+static uint16_t instr_flags_killed(dis86_instr_t *ins)
+{
+  switch (ins->opcode) {
+    case operation_e::SHL:
+    case operation_e::SHR:
+    case operation_e::SAR:
+    case operation_e::ROL:
+    case operation_e::ROR:
+    case operation_e::RCL:
+    case operation_e::RCR:
+      // A count of zero leaves every flag alone
+      if (ins->operand[1].type == OPERAND_TYPE_REG) return 0;
+      break;
+    case operation_e::CMPS:
+    case operation_e::SCAS:
+      // ... and so does a repeated compare with CX == 0
+      if (ins->rep != REP_NONE) return 0;
+      break;
+    default:
+      break;
+  }
+  return instr_flags[size_t(ins->opcode)].written;
+}
+
+flags_t * flags_new(meh_t *m, const cfg_t *cfg, const dom_t *dom, dis86_instr_t *ins_base)
+{
+  assert(dom->cfg_version == cfg->version);
+
+  size_t   n_expr   = m->expr_len;
+  uint32_t n_blocks = cfg->n_blocks;
+
+  flags_t *f  = (flags_t*)calloc(1, sizeof(flags_t));
+  f->n_expr   = n_expr;
+  f->written  = (uint16_t*)calloc(n_expr ? n_expr : 1, sizeof(uint16_t));
+  f->live_out = (uint16_t*)calloc(n_expr ? n_expr : 1, sizeof(uint16_t));
+
+  uint16_t *read  = (uint16_t*)calloc(n_expr ? n_expr : 1, sizeof(uint16_t));
+  uint16_t *kill  = (uint16_t*)calloc(n_expr ? n_expr : 1, sizeof(uint16_t));
+  uint32_t *block = (uint32_t*)malloc((n_expr ? n_expr : 1) * sizeof(uint32_t));
+
+  // Per-expression summaries
+  for (size_t e = 0; e < n_expr; e++) {
+    expr_t *expr = &m->expr_arr[e];
+    block[e] = CFG_NONE;
+    if (!expr->n_ins) continue;
+    block[e] = cfg->block_of[(expr->ins - ins_base) + expr->n_ins - 1];
+
+    bool explicit_cond = expr->kind == EXPR_KIND_BRANCH_COND;
+    for (size_t i = 0; i < expr->n_ins; i++) {
+      dis86_instr_t *ins = &expr->ins[i];
+      if (!explicit_cond) read[e] |= instr_flags[size_t(ins->opcode)].read & ~kill[e];
+      f->written[e] |= instr_flags[size_t(ins->opcode)].written;
+      kill[e]       |= instr_flags_killed(ins);
+    }
+  }
+
+  // Per-block summaries. Exprs are in address order, so walking them once
+  // visits each block's exprs contiguously and in order.
+  uint16_t *gen      = (uint16_t*)calloc(n_blocks ? n_blocks : 1, sizeof(uint16_t));
+  uint16_t *bkill    = (uint16_t*)calloc(n_blocks ? n_blocks : 1, sizeof(uint16_t));
+  uint16_t *live_in  = (uint16_t*)calloc(n_blocks ? n_blocks : 1, sizeof(uint16_t));
+  uint16_t *live_out = (uint16_t*)calloc(n_blocks ? n_blocks : 1, sizeof(uint16_t));
+  for (size_t e = 0; e < n_expr; e++) {
+    uint32_t b = block[e];
+    if (b == CFG_NONE) continue;
+    gen[b]   |= read[e] & ~bkill[b];
+    bkill[b] |= kill[e];
+  }
+
+  for (uint32_t b = 0; b < n_blocks; b++) {
+    if (!dom_reachable(dom, b)) live_out[b] = FLAG_ALL;
+  }
+  for (bool changed = true; changed; ) {
+    changed = false;
+    for (uint32_t i = dom->n_rpo; i-- > 0; ) {
+      uint32_t b = dom->rpo[i];
+      uint16_t out = cfg->exits[b] ? FLAG_ALL : 0;
+      for (size_t j = 0; j < cfg_n_succ(cfg, b); j++) out |= live_in[cfg_succ(cfg, b)[j]];
+      uint16_t in = gen[b] | (out & ~bkill[b]);
+      live_out[b] = out;
+      if (in != live_in[b]) {
+        live_in[b] = in;
+        changed = true;
+      }
+    }
+  }
+
+  // Back down to expressions
+  uint32_t cur_block = CFG_NONE;
+  uint16_t live = 0;
+  for (size_t e = n_expr; e-- > 0; ) {
+    uint32_t b = block[e];
+    if (b == CFG_NONE) continue;
+    if (b != cur_block) {
+      cur_block = b;
+      live = live_out[b];
+    }
+    f->live_out[e] = live;
+    live = (live & ~kill[e]) | read[e];
+  }
+
+  free(read);
+  free(kill);
+  free(block);
+  free(gen);
+  free(bkill);
+  free(live_in);
+  free(live_out);
+  return f;
+}
+
+void flags_delete(flags_t *f)
+{
+  free(f->written);
+  free(f->live_out);
+  free(f);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <unistd.h>
+
+#include "expr.h"
+#include "cfg.h"
+#include "dom.h"
+
+// Lazy flags: which flag bits each expression writes and which of those can
+// ever be observed
+//
+// Backward liveness over the CFG, one bit per flag, at expression
+// granularity. An expression reads the bits its instructions read before
+// writing them itself, except fused compare-and-branch expressions, which
+// carry their condition explicitly and read nothing. Shifts and rotates by
+// CL and REP-prefixed string compares may leave the flags untouched, so they
+// write but never kill. Anything leaving the function is assumed to read
+// every flag (DOS code commonly returns status in CF), as is anything in
+// unreachable code.
+
+typedef struct flags flags_t;
+struct flags
+{
+  size_t     n_expr;
+  uint16_t * written;    /* per expr: bits it may write */
+  uint16_t * live_out;   /* per expr: bits read later before being overwritten */
+};
+
+flags_t * flags_new(meh_t *m, const cfg_t *cfg, const dom_t *dom, dis86_instr_t *ins_base);
+void      flags_delete(flags_t *f);
+
+static inline uint16_t flags_observed(const flags_t *f, size_t expr_idx)
+{
+  return f->written[expr_idx] & f->live_out[expr_idx];
+}
@@ -2,23 +2,27 @@
 #include <unistd.h>
 
 #include "instr.h"
+#include "common/stats.h"
 
-#define MAX_LABELS 256
+#include <algorithm>
 
 typedef struct labels labels_t;
 struct labels
 {
-  uint32_t addr[MAX_LABELS];
-  size_t n_addr;
+  uint32_t * addr;  /* sorted, unique */
+  size_t     n_addr;
 };
 
-// FIXME: O(n) search
 static bool is_label(labels_t *labels, uint32_t addr)
 {
-  for (size_t i = 0; i < labels->n_addr; i++) {
-    if (labels->addr[i] == addr) return true;
-  }
-  return false;
+  return std::binary_search(labels->addr, labels->addr + labels->n_addr, addr);
+}
+
+static inline void labels_release(labels_t *labels)
+{
+  free(labels->addr);
+  labels->addr   = nullptr;
+  labels->n_addr = 0;
 }
 
 static uint32_t branch_destination(dis86_instr_t *ins)
@@ -52,14 +56,18 @@ static uint32_t branch_destination(dis86_instr_t *ins)
 
 static void find_labels(labels_t *labels, dis86_instr_t *ins_arr, size_t n_ins)
 {
-  labels->n_addr = 0;
+  labels_release(labels);
+  labels->addr = (uint32_t*)malloc((n_ins ? n_ins : 1) * sizeof(uint32_t));
 
   for (size_t i = 0; i < n_ins; i++) {
     dis86_instr_t *ins = &ins_arr[i];
     uint16_t dst = branch_destination(ins);
     if (!dst) continue;
 
-    assert(labels->n_addr < ARRAY_SIZE(labels->addr));
     labels->addr[labels->n_addr++] = dst;
   }
+
+  std::sort(labels->addr, labels->addr + labels->n_addr);
+  labels->n_addr = std::unique(labels->addr, labels->addr + labels->n_addr) - labels->addr;
+  STAT_ADD(LABELS_FOUND, labels->n_addr);
 }
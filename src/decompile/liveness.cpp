@@ -0,0 +1,219 @@
+#include "decompile_private.h"
+
+// Registers lying entirely within each register: what writing it kills
+static constexpr std::array<uint32_t, _REG_LAST> reg_covers = [] {
+  std::array<uint32_t, _REG_LAST> arr {};
+  for (int a = 1; a < _REG_LAST; a++) {
+    for (int b = 1; b < _REG_LAST; b++) {
+      int a_end = reg_info[a].off + reg_info[a].bits/8;
+      int b_end = reg_info[b].off + reg_info[b].bits/8;
+      if (reg_info[a].off <= reg_info[b].off && b_end <= a_end) arr[a] |= REG_BIT(b);
+    }
+  }
+  return arr;
+}();
+
+static inline uint32_t reg_use(int reg)   { return reg_info[reg].alias & REGS_ALL; }
+static inline uint32_t reg_kill(int reg)  { return reg_covers[reg] & REGS_ALL; }
+
+static uint32_t mem_use(int sreg, int reg1, int reg2)
+{
+  return reg_use(sreg) | reg_use(reg1) | reg_use(reg2);
+}
+
+// Registers sharing a byte with [off, off+len) of the register file
+static uint32_t regs_overlapping(int off, int len)
+{
+  uint32_t mask = 0;
+  for (int r = 1; r < _REG_LAST; r++) {
+    if (reg_info[r].off < off + len && off < reg_info[r].off + reg_info[r].bits/8) mask |= REG_BIT(r);
+  }
+  return mask & REGS_ALL;
+}
+
+static uint32_t value_use(const symbols_t *symbols, const value_t *v)
+{
+  switch (v->type) {
+    case VALUE_TYPE_SYM: {
+      const symref_t *ref = &v->u.sym->ref;
+      switch (SYM_ID_KIND(ref->id)) {
+        case SYM_KIND_REGISTER: return regs_overlapping(symbols_sym(symbols, ref->id)->off + ref->off, ref->len);
+        case SYM_KIND_PARAM:    return mem_use(REG_SS, REG_BP, REG_INVAL);
+        case SYM_KIND_LOCAL:    return mem_use(REG_SS, REG_BP, REG_INVAL);
+        case SYM_KIND_GLOBAL:   return mem_use(REG_DS, REG_INVAL, REG_INVAL);
+        default:                return 0;
+      }
+    }
+    case VALUE_TYPE_MEM:
+      return mem_use(v->u.mem->sreg, v->u.mem->reg1, v->u.mem->reg2);
+    default:
+      return 0;
+  }
+}
+
+static void instr_regs_of(dis86_instr_t *ins, uint32_t *use, uint32_t *def, uint32_t *kill)
+{
+  const instr_regs_t& r = instr_regs[size_t(ins->opcode)];
+  uint8_t read    = r.read;
+  uint8_t written = r.written;
+  *use  = r.use;
+  *def  = r.def;
+  *kill = r.def;
+
+  switch (ins->opcode) {
+    case operation_e::IMUL:
+      // Only the one operand form writes DX:AX (or AX)
+      if (ins->operand[2].type == OPERAND_TYPE_IMM) written = 1<<0;
+      break;
+    case operation_e::XOR:
+    case operation_e::SUB:
+      // xor r,r and sub r,r don't depend on r
+      if (ins->operand[0].type == OPERAND_TYPE_REG && ins->operand[1].type == OPERAND_TYPE_REG &&
+          ins->operand[0].u.reg.id == ins->operand[1].u.reg.id) read = 0;
+      break;
+    default:
+      break;
+  }
+
+  for (size_t i = 0; i < ARRAY_SIZE(ins->operand); i++) {
+    operand_t *o = &ins->operand[i];
+    if (o->type == OPERAND_TYPE_REG) {
+      if (read & (1<<i)) *use |= reg_use(o->u.reg.id);
+      if (written & (1<<i)) {
+        *def  |= REG_BIT(o->u.reg.id) & REGS_ALL;
+        *kill |= reg_kill(o->u.reg.id);
+      }
+    } else if (o->type == OPERAND_TYPE_MEM) {
+      // The address is computed whichever way the operand goes
+      *use |= mem_use(o->u.mem.sreg, o->u.mem.reg1, o->u.mem.reg2);
+    }
+  }
+
+  // A repeated string operation runs CX times, possibly not at all
+  if (ins->rep != REP_NONE) {
+    *use  |= reg_use(REG_CX);
+    *def  |= REG_BIT(REG_CX);
+    *kill  = 0;
+  }
+}
+
+liveness_t * liveness_new(meh_t *m, const symbols_t *symbols, const cfg_t *cfg, const dom_t *dom,
+                          dis86_instr_t *ins_base)
+{
+  assert(dom->cfg_version == cfg->version);
+
+  size_t   n_expr   = m->expr_len;
+  uint32_t n_blocks = cfg->n_blocks;
+
+  liveness_t *l = (liveness_t*)calloc(1, sizeof(liveness_t));
+  l->n_expr   = n_expr;
+  l->def      = (uint32_t*)calloc(n_expr ? n_expr : 1, sizeof(uint32_t));
+  l->live_out = (uint32_t*)calloc(n_expr ? n_expr : 1, sizeof(uint32_t));
+
+  uint32_t *read  = (uint32_t*)calloc(n_expr ? n_expr : 1, sizeof(uint32_t));
+  uint32_t *kill  = (uint32_t*)calloc(n_expr ? n_expr : 1, sizeof(uint32_t));
+  uint32_t *block = (uint32_t*)malloc((n_expr ? n_expr : 1) * sizeof(uint32_t));
+
+  // Per-expression summaries
+  for (size_t e = 0; e < n_expr; e++) {
+    expr_t *expr = &m->expr_arr[e];
+    block[e] = CFG_NONE;
+    if (!expr->n_ins) continue;
+    block[e] = cfg->block_of[(expr->ins - ins_base) + expr->n_ins - 1];
+    if (expr->kind == EXPR_KIND_NONE) continue;
+
+    for (size_t i = 0; i < expr->n_ins; i++) {
+      uint32_t use, def, k;
+      instr_regs_of(&expr->ins[i], &use, &def, &k);
+      read[e]     |= use & ~kill[e];
+      l->def[e]   |= def;
+      kill[e]     |= k;
+    }
+    if (expr->kind == EXPR_KIND_BRANCH_COND) {
+      // The compare may have been fused from further up
+      read[e] |= value_use(symbols, &expr->k.branch_cond->left);
+      read[e] |= value_use(symbols, &expr->k.branch_cond->right);
+    }
+  }
+
+  // Per-block summaries. Exprs are in address order, so walking them once
+  // visits each block's exprs contiguously and in order.
+  uint32_t *gen      = (uint32_t*)calloc(n_blocks ? n_blocks : 1, sizeof(uint32_t));
+  uint32_t *bkill    = (uint32_t*)calloc(n_blocks ? n_blocks : 1, sizeof(uint32_t));
+  uint32_t *live_in  = (uint32_t*)calloc(n_blocks ? n_blocks : 1, sizeof(uint32_t));
+  uint32_t *live_out = (uint32_t*)calloc(n_blocks ? n_blocks : 1, sizeof(uint32_t));
+  for (size_t e = 0; e < n_expr; e++) {
+    uint32_t b = block[e];
+    if (b == CFG_NONE) continue;
+    gen[b]   |= read[e] & ~bkill[b];
+    bkill[b] |= kill[e];
+  }
+
+  for (uint32_t b = 0; b < n_blocks; b++) {
+    if (!dom_reachable(dom, b)) live_out[b] = REGS_ALL;
+  }
+  for (bool changed = true; changed; ) {
+    changed = false;
+    for (uint32_t i = dom->n_rpo; i-- > 0; ) {
+      uint32_t b = dom->rpo[i];
+      uint32_t out = cfg->exits[b] ? REGS_ALL : 0;
+      for (size_t j = 0; j < cfg_n_succ(cfg, b); j++) out |= live_in[cfg_succ(cfg, b)[j]];
+      uint32_t in = gen[b] | (out & ~bkill[b]);
+      live_out[b] = out;
+      if (in != live_in[b]) {
+        live_in[b] = in;
+        changed = true;
+      }
+    }
+  }
+
+  // Back down to expressions
+  uint32_t cur_block = CFG_NONE;
+  uint32_t live = 0;
+  for (size_t e = n_expr; e-- > 0; ) {
+    uint32_t b = block[e];
+    if (b == CFG_NONE) continue;
+    if (b != cur_block) {
+      cur_block = b;
+      live = live_out[b];
+    }
+    l->live_out[e] = live;
+    live = (live & ~kill[e]) | read[e];
+  }
+
+  free(read);
+  free(kill);
+  free(block);
+  free(gen);
+  free(bkill);
+  free(live_in);
+  free(live_out);
+  return l;
+}
+
+void liveness_delete(liveness_t *l)
+{
+  free(l->def);
+  free(l->live_out);
+  free(l);
+}
+
+static std::string regs_str(uint32_t mask)
+{
+  std::string s;
+  for (int r = 1; r < _REG_LAST; r++) {
+    if (!(mask & REG_BIT(r))) continue;
+    if (!s.empty()) s += " ";
+    s += reg_name(r);
+  }
+  return s;
+}
+
+void liveness_dump(const liveness_t *l)
+{
+  for (size_t e = 0; e < l->n_expr; e++) {
+    if (!l->def[e] && !l->live_out[e]) continue;
+    fprintf(stderr, "  expr  %-5zu | def %-20s | live %s%s\n", e, regs_str(l->def[e]).c_str(),
+            regs_str(l->live_out[e]).c_str(), (l->def[e] && !liveness_observed(l, e)) ? " | dead" : "");
+  }
+}
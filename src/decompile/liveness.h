@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <unistd.h>
+
+#include "expr.h"
+#include "cfg.h"
+#include "dom.h"
+
+// Register liveness: which registers each expression writes and which of
+// those can ever be read
+//
+// Backward liveness over the CFG, one bit per register id (REG_BIT), at
+// expression granularity. Masks come from instr_regs applied to each
+// instruction's decoded operands. Reading a register reads everything it
+// aliases (reading AX reads AL and AH), but writing one only kills the
+// registers it covers, so a write to AL leaves a live AX live. A fused
+// compare-and-branch reads the registers of its condition, and dropped
+// expressions read and write nothing.
+//
+// Anything leaving the function is assumed to read every register, as is
+// anything in unreachable code, an interrupt and every call: even callees
+// with a config signature get the whole machine and runtime helpers often
+// take their arguments in registers.
+
+typedef struct liveness liveness_t;
+struct liveness
+{
+  size_t     n_expr;
+  uint32_t * def;        /* per expr: registers it may write */
+  uint32_t * live_out;   /* per expr: registers read later before being overwritten */
+};
+
+liveness_t * liveness_new(meh_t *m, const symbols_t *symbols, const cfg_t *cfg, const dom_t *dom,
+                          dis86_instr_t *ins_base);
+void         liveness_delete(liveness_t *l);
+void         liveness_dump(const liveness_t *l);
+
+static inline uint32_t liveness_observed(const liveness_t *l, size_t expr_idx)
+{
+  return l->def[expr_idx] & l->live_out[expr_idx];
+}
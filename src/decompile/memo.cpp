@@ -0,0 +1,158 @@
+#include "decompile_private.h"
+#include "common/hash.h"
+
+#include <unordered_map>
+
+typedef struct memo_entry memo_entry_t;
+struct memo_entry
+{
+  memo_key_t                 key;
+  size_t                     base;  /* address of the first instruction */
+  std::vector<dis86_instr_t> ins;
+  std::vector<expr_t>        exprs; /* ins pointers refer into 'ins' above */
+  symbols_t *                symbols;
+};
+
+struct memo
+{
+  std::unordered_map<uint64_t, memo_entry_t*> entries;
+};
+
+memo_t * memo_new(void)
+{
+  return new memo_t;
+}
+
+void memo_delete(memo_t *m)
+{
+  if (!m) return;
+  for (auto& [hash, ent] : m->entries) {
+    symbols_delete(ent->symbols);
+    delete ent;
+  }
+  delete m;
+}
+
+void memo_key_init(memo_key_t *key, dis86_t *dis, dis86_decompile_config_t *cfg,
+                   uint16_t seg, dis86_instr_t *ins, size_t n_ins)
+{
+  binary_t *b = dis->b;
+
+  key->sig.clear();
+  for (size_t i = 0; i < n_ins; i++) {
+    key->sig.push_back(0x200 | (uint16_t)ins[i].n_bytes);
+    for (size_t a = ins[i].addr; a < ins[i].addr + ins[i].n_bytes; a++) {
+      bool reloc = b->relocs && b->relocs->overlaps((uint32_t)a, 1);
+      key->sig.push_back((reloc ? 0x100 : 0) | binary_byte_at(b, a));
+    }
+  }
+
+  key->deps = config_deps_hash(cfg, seg, ins, n_ins);
+  key->seg  = seg;
+  key->hash = hash_u64(hash_bytes(HASH_INIT, key->sig.data(), key->sig.size() * sizeof(uint16_t)), key->deps);
+}
+
+static void rebase_expr(expr_t *expr, ptrdiff_t delta)
+{
+  switch (expr->kind) {
+    case EXPR_KIND_BRANCH_COND:  expr->k.branch_cond->target  += delta; break;
+    case EXPR_KIND_BRANCH_FLAGS: expr->k.branch_flags->target += delta; break;
+    case EXPR_KIND_BRANCH:       expr->k.branch->target       += delta; break;
+    case EXPR_KIND_CALL: {
+      addr_t *addr = &expr->k.call->addr;
+      if (addr->type == addr_type_e::ADDR_TYPE_NEAR) addr->u.near += delta;
+    } break;
+    case EXPR_KIND_CALL_WITH_ARGS: {
+      addr_t *addr = &expr->k.call_with_args->addr;
+      if (addr->type == addr_type_e::ADDR_TYPE_NEAR) addr->u.near += delta;
+    } break;
+    default: break;
+  }
+}
+
+meh_t * memo_lookup(memo_t *m, const memo_key_t *key, dis86_instr_t *ins, symbols_t **_symbols,
+                    arena_t *opt_arena)
+{
+  auto it = m->entries.find(key->hash);
+  if (it == m->entries.end()) return nullptr;
+
+  memo_entry_t *ent = it->second;
+  if (ent->key.deps != key->deps || ent->key.sig != key->sig) return nullptr;
+
+  ptrdiff_t delta = ent->ins.empty() ? 0 : (ptrdiff_t)ins[0].addr - (ptrdiff_t)ent->base;
+
+  size_t n = ent->exprs.size();
+  meh_t *meh = nullptr;
+  if (opt_arena) {
+    meh = arena_calloc<meh_t>(opt_arena, 1);
+    meh->expr_arr = arena_calloc<expr_t>(opt_arena, n);
+    meh->arena = opt_arena;
+  } else {
+    meh = (meh_t*)calloc(1, sizeof(meh_t));
+    meh->expr_arr = (expr_t*)calloc(n ? n : 1, sizeof(expr_t));
+  }
+  meh->expr_len = n;
+  for (size_t i = 0; i < meh->expr_len; i++) {
+    expr_t *expr = &meh->expr_arr[i];
+    *expr = ent->exprs[i];
+    if (expr->n_ins) expr->ins = ins + (expr->ins - ent->ins.data());
+    if (delta) rebase_expr(expr, delta);
+  }
+
+  *_symbols = ent->symbols;
+  return meh;
+}
+
+bool memo_insert(memo_t *m, const memo_key_t *key, dis86_instr_t *ins, size_t n_ins,
+                 symbols_t *symbols, meh_t *meh)
+{
+  if (m->entries.count(key->hash)) return false;
+
+  memo_entry_t *ent = new memo_entry_t;
+  ent->key     = *key;
+  ent->base    = n_ins ? ins[0].addr : 0;
+  ent->ins.assign(ins, ins + n_ins);
+  ent->exprs.assign(meh->expr_arr, meh->expr_arr + meh->expr_len);
+  ent->symbols = symbols_copy(symbols);
+  for (expr_t& expr : ent->exprs) {
+    if (expr.n_ins) expr.ins = ent->ins.data() + (expr.ins - ins);
+  }
+
+  m->entries[key->hash] = ent;
+  return true;
+}
+
+size_t memo_size(memo_t *m)
+{
+  return m ? m->entries.size() : 0;
+}
+
+size_t memo_rebind(memo_t *m, dis86_decompile_config_t *cfg, bool check_deps)
+{
+  size_t dropped = 0;
+  for (auto it = m->entries.begin(); it != m->entries.end();) {
+    memo_entry_t *ent = it->second;
+
+    // Same hash means every call target and global this function consults
+    // looks the same in 'cfg', including lookups that missed before
+    if (check_deps && config_deps_hash(cfg, ent->key.seg, ent->ins.data(), ent->ins.size()) != ent->key.deps) {
+      symbols_delete(ent->symbols);
+      delete ent;
+      it = m->entries.erase(it);
+      dropped++;
+      continue;
+    }
+
+    for (expr_t& expr : ent->exprs) {
+      config_func_t **func = nullptr;
+      if (expr.kind == EXPR_KIND_CALL)           func = &expr.k.call->func;
+      if (expr.kind == EXPR_KIND_CALL_WITH_ARGS) func = &expr.k.call_with_args->func;
+      if (!func || !*func) continue;
+      *func = config_func_lookup(cfg, (*func)->addr);
+      assert(*func);
+    }
+
+    ++it;
+  }
+  return dropped;
+}
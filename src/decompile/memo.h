@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <unistd.h>
+#include <vector>
+
+#include "dis86.h"
+#include "symbols.h"
+#include "expr.h"
+
+// Decompile memo: reuses the analysis of a function whose bytes have already
+// been seen under the same config
+//
+// Multi-overlay programs link the same runtime routines into many segments.
+// Everything the analysis produces is position independent except branch
+// targets and near call addresses, which move with the function, so a hit
+// hands back a copy of the cached expressions rebased onto the new
+// instructions and only the (cheap) emit runs again.
+//
+// The key is the raw bytes of each instruction, with words the loader
+// patches tagged as such, plus a hash of the config entries the function
+// consults. Keys are compared in full on lookup, so a hash collision is a
+// miss rather than wrong output.
+//
+// A memo belongs to a config: cached expressions point at its function
+// entries. memo_rebind() hands it over to a re-read of the config, keeping
+// only what the edit didn't touch.
+
+typedef struct memo     memo_t;
+typedef struct memo_key memo_key_t;
+
+struct memo_key
+{
+  uint64_t              hash;
+  uint64_t              deps;
+  uint16_t              seg;   /* to recompute 'deps' against another config */
+  std::vector<uint16_t> sig;
+};
+
+memo_t * memo_new(void);
+void     memo_delete(memo_t *m);
+
+void     memo_key_init(memo_key_t *key, dis86_t *dis, dis86_decompile_config_t *cfg,
+                       uint16_t seg, dis86_instr_t *ins, size_t n_ins);
+
+/* On a hit: returns a rebased copy of the cached expressions (from the arena
+   if one is given, else the caller frees) and lends out the cached symbols.
+   nullptr on a miss. */
+meh_t *  memo_lookup(memo_t *m, const memo_key_t *key, dis86_instr_t *ins, symbols_t **_symbols,
+                     arena_t *opt_arena);
+
+/* Copies 'symbols' and 'meh' (neither needs to outlive the call) when it
+   returns true */
+bool     memo_insert(memo_t *m, const memo_key_t *key, dis86_instr_t *ins, size_t n_ins,
+                     symbols_t *symbols, meh_t *meh);
+
+size_t   memo_size(memo_t *m);
+
+/* Repoints every entry from the config it was built under (still alive) to
+   'cfg'. With 'check_deps', entries whose consulted config entries differ
+   in 'cfg' are dropped instead. Returns the number dropped. */
+size_t   memo_rebind(memo_t *m, dis86_decompile_config_t *cfg, bool check_deps);
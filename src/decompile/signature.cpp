@@ -0,0 +1,200 @@
+#include "decompile_private.h"
+#include "common/common.h"
+#include "bsl/bsl.h"
+
+static int hex_digit(char c)
+{
+  if ('0' <= c && c <= '9') return c - '0';
+  if ('a' <= c && c <= 'f') return c - 'a' + 10;
+  if ('A' <= c && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static bool parse_pattern(signature_t *sig, const char *s)
+{
+  while (*s) {
+    if (*s == ' ' || *s == '\t') { s++; continue; }
+    if (s[0] == '?' && s[1] == '?') {
+      sig->bytes.push_back(0);
+      sig->mask.push_back(0);
+      s += 2;
+      continue;
+    }
+    int hi = hex_digit(s[0]);
+    int lo = hi < 0 ? -1 : hex_digit(s[1]);
+    if (lo < 0) return false;
+    sig->bytes.push_back((uint8_t)(hi*16 + lo));
+    sig->mask.push_back(0xff);
+    s += 2;
+  }
+  return !sig->bytes.empty();
+}
+
+static void build_index(signatures_t *s)
+{
+  memset(s->present, 0, sizeof(s->present));
+  s->bucket_off.assign((1<<16) + 1, 0);
+  s->wild.clear();
+
+  auto leading = [](const signature_t *sig) -> int {
+    if (sig->bytes.size() < 2 || sig->mask[0] != 0xff || sig->mask[1] != 0xff) return -1;
+    return sig->bytes[0] | (sig->bytes[1] << 8);
+  };
+
+  // Count, prefix-sum, scatter: buckets keep file order so earlier
+  // signatures win ties
+  for (const signature_t& sig : s->arr) {
+    int w = leading(&sig);
+    if (w >= 0) s->bucket_off[w+1]++;
+  }
+  for (size_t w = 0; w < (1<<16); w++) s->bucket_off[w+1] += s->bucket_off[w];
+
+  s->bucket.resize(s->bucket_off[1<<16]);
+  std::vector<uint32_t> cursor(s->bucket_off.begin(), s->bucket_off.end() - 1);
+  for (uint32_t i = 0; i < s->arr.size(); i++) {
+    int w = leading(&s->arr[i]);
+    if (w < 0) {
+      s->wild.push_back(i);
+      continue;
+    }
+    s->bucket[cursor[w]++] = i;
+    s->present[w/64] |= (uint64_t)1 << (w%64);
+  }
+}
+
+signatures_t * signatures_read_new(const char *path)
+{
+  dynarray data = read_file(path);
+  if (data.empty()) FAIL("Failed to read file: '%s'", path);
+
+  bsl::node_t *root = bsl::parse_new(data, nullptr);
+  if (!root) FAIL("Failed to read the signature file");
+
+  bsl::node_t *sigs = bsl::get_node(root, "dis86.signatures");
+  if (!sigs) FAIL("Failed to get signatures node");
+
+  signatures_t *s = new signatures_t;
+
+  bsl::iter_t     it[1];
+  bsl::node_e     type;
+  const char *    key;
+  bsl::node_val_t val;
+
+  bsl::iter_begin(it, sigs);
+  while (bsl::iter_next(it, type, &key, val)) {
+    if (type != bsl::node_e::node) FAIL("Expected signature properties");
+    bsl::node_t *n = val.node;
+
+    const char *pattern_str = bsl::get_str(n, "pattern");
+    if (!pattern_str) FAIL("No signature pattern property for '%s'", key);
+
+    const char *ret_str = bsl::get_str(n, "ret");
+    if (!ret_str) FAIL("No signature ret property for '%s'", key);
+
+    const char *args_str = bsl::get_str(n, "args");
+    if (!args_str) FAIL("No signature args property for '%s'", key);
+
+    int16_t args;
+    if (!parse_bytes_int16_t(args_str, strlen(args_str), &args)) FAIL("Expected int16_t for '%s.args', got '%s'", key, args_str);
+
+    signature_t sig = {};
+    if (!parse_pattern(&sig, pattern_str)) FAIL("Invalid pattern for '%s': '%s'", key, pattern_str);
+    sig.name = strdup(key);
+    sig.ret  = strdup(ret_str);
+    sig.args = args;
+    sig.pop_args_after_call = !bsl::get_str(n, "dont_pop_args");
+    s->arr.push_back(std::move(sig));
+  }
+
+  bsl::free_node(root);
+  build_index(s);
+  if (!s->wild.empty()) {
+    LOG_WARN("%zu signature(s) start with a wildcard and will be tried at every address", s->wild.size());
+  }
+  return s;
+}
+
+void signatures_delete(signatures_t *s)
+{
+  if (!s) return;
+  for (signature_t& sig : s->arr) {
+    free(sig.name);
+    free(sig.ret);
+  }
+  delete s;
+}
+
+static bool sig_matches(const signature_t *sig, const uint8_t *p, size_t avail)
+{
+  size_t len = sig->bytes.size();
+  if (len > avail) return false;
+  for (size_t i = 0; i < len; i++) {
+    if ((p[i] & sig->mask[i]) != sig->bytes[i]) return false;
+  }
+  return true;
+}
+
+size_t signatures_apply(signatures_t *s, dis86_decompile_config_t *cfg,
+                        segment<uint8_t> mem, size_t base_addr, uint16_t seg)
+{
+  // Only what 'seg' can address: [seg:0000, seg:ffff]
+  size_t seg_lo = 16*(size_t)seg;
+  size_t lo = std::max(base_addr, seg_lo);
+  size_t hi = std::min(base_addr + mem.size(), seg_lo + (1<<16));
+  if (lo >= hi) return 0;
+
+  const uint8_t *data = mem.data();
+  size_t end = mem.size();
+  size_t n_added = 0;
+
+  for (size_t i = lo - base_addr; i < hi - base_addr; ) {
+    const signature_t *found = nullptr;
+
+    if (i+1 < end) {
+      uint32_t w = data[i] | (data[i+1] << 8);
+      if (s->present[w/64] & ((uint64_t)1 << (w%64))) {
+        for (uint32_t j = s->bucket_off[w]; j < s->bucket_off[w+1]; j++) {
+          const signature_t *sig = &s->arr[s->bucket[j]];
+          if (sig_matches(sig, data + i, end - i)) { found = sig; break; }
+        }
+      }
+    }
+    for (size_t j = 0; !found && j < s->wild.size(); j++) {
+      const signature_t *sig = &s->arr[s->wild[j]];
+      if (sig_matches(sig, data + i, end - i)) found = sig;
+    }
+
+    if (!found) {
+      i++;
+      continue;
+    }
+
+    // Configured functions win over recognised ones
+    segoff_t addr = {seg, (uint16_t)(base_addr + i - seg_lo)};
+    if (!config_func_lookup(cfg, addr)) {
+      if (cfg->func_len == ARRAY_SIZE(cfg->func_arr)) {
+        LOG_WARN("Function table full, dropping signature matches from %04x:%04x on", addr.seg, addr.off);
+        break;
+      }
+      config_func_t *cf = &cfg->func_arr[cfg->func_len++];
+      cf->name = strdup(found->name);
+      cf->addr = addr;
+      cf->ret  = strdup(found->ret);
+      cf->args = found->args;
+      cf->pop_args_after_call = found->pop_args_after_call;
+      n_added++;
+    }
+    i += found->bytes.size();
+  }
+
+  return n_added;
+}
+
+size_t dis86_decompile_config_apply_signatures(dis86_decompile_config_t *cfg, const char *sig_path,
+                                               segment<uint8_t> mem, size_t base_addr, uint16_t seg)
+{
+  signatures_t *s = signatures_read_new(sig_path);
+  size_t n = signatures_apply(s, cfg, mem, base_addr, seg);
+  signatures_delete(s);
+  return n;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <unistd.h>
+#include <vector>
+
+#include "config.h"
+#include "common/segment.h"
+
+// Library signatures: recognise known runtime routines by their bytes and
+// add them to the config's function table
+//
+// A signature file is BSL, with entries shaped like config functions but
+// carrying a byte pattern instead of an address:
+//
+//   dis86 {
+//     signatures {
+//       _strlen { pattern "55 8B EC 1E C4 7E 06 ?? ?? 33 C0" ret "u16" args "2" }
+//     }
+//   }
+//
+// Pattern bytes are hex, "??" matches anything (relocated words, call
+// displacements). Signatures are indexed by their first two bytes, so the
+// scan is a single pass that does one bitmap test per position and only
+// compares patterns whose leading word matches. Signatures that start with
+// a wildcard are tried everywhere and are best avoided.
+
+typedef struct signature  signature_t;
+typedef struct signatures signatures_t;
+
+struct signature
+{
+  char *               name;
+  char *               ret;
+  int16_t              args;
+  bool                 pop_args_after_call;
+  std::vector<uint8_t> bytes;
+  std::vector<uint8_t> mask;  /* 0xff where the byte must match */
+};
+
+struct signatures
+{
+  std::vector<signature_t> arr;
+  uint64_t                 present[(1<<16)/64];  /* leading words with any bucket */
+  std::vector<uint32_t>    bucket_off;           /* CSR over leading word */
+  std::vector<uint32_t>    bucket;
+  std::vector<uint32_t>    wild;                 /* leading word not fully specified */
+};
+
+signatures_t * signatures_read_new(const char *path);
+void           signatures_delete(signatures_t *s);
+
+/* Scan the part of 'mem' (starting at linear 'base_addr') visible from 'seg',
+   adding a config function for every match not already configured.
+   Returns the number added. */
+size_t         signatures_apply(signatures_t *s, dis86_decompile_config_t *cfg,
+                                segment<uint8_t> mem, size_t base_addr, uint16_t seg);
@@ -0,0 +1,533 @@
+#include "decompile_private.h"
+
+#include <algorithm>
+
+uint32_t ssa_var_of(const ssa_t *ssa, sym_id_t id)
+{
+  const symbols_t *s = ssa->symbols;
+  uint32_t idx = (uint32_t)SYM_ID_INDEX(id);
+  switch (SYM_ID_KIND(id)) {
+    case SYM_KIND_REGISTER: return idx;
+    case SYM_KIND_PARAM:    return (uint32_t)s->registers->n_var + idx;
+    case SYM_KIND_LOCAL:    return (uint32_t)(s->registers->n_var + s->params->n_var) + idx;
+    default:                return SSA_NONE;
+  }
+}
+
+uint32_t ssa_reaching_def(const ssa_t *ssa, size_t expr_idx, uint32_t var)
+{
+  for (uint32_t u = ssa->use_off[expr_idx]; u < ssa->use_off[expr_idx+1]; u++) {
+    if (ssa->uses[u].var == var) return ssa->uses[u].def;
+  }
+  return SSA_NONE;
+}
+
+uint32_t ssa_expr_def(const ssa_t *ssa, size_t expr_idx, uint32_t var)
+{
+  for (uint32_t d = ssa->def_off[expr_idx]; d < ssa->def_off[expr_idx+1]; d++) {
+    uint32_t def = ssa->expr_defs[d];
+    if (ssa->defs[def].var == var) return def;
+  }
+  return SSA_NONE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Per-expression effects
+
+static bool instr_moves_stack(operation_e op)
+{
+  switch (op) {
+    case operation_e::PUSH: case operation_e::POP:  case operation_e::PUSHF: case operation_e::POPF:
+    case operation_e::PUSHA: case operation_e::POPA: case operation_e::CALL: case operation_e::CALLF:
+    case operation_e::RET:  case operation_e::RETF: case operation_e::IRET: case operation_e::INT:
+    case operation_e::ENTER: case operation_e::LEAVE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+typedef struct effects effects_t;
+struct effects
+{
+  const ssa_t *         ssa;
+  std::vector<uint32_t> use;
+  std::vector<uint32_t> def;
+  std::vector<uint32_t> use_mark;   /* per var: last expr that recorded it */
+  std::vector<uint32_t> def_mark;
+  uint32_t              cur;
+};
+
+static void add_use(effects_t *eff, uint32_t var)
+{
+  if (var == SSA_NONE || eff->use_mark[var] == eff->cur) return;
+  eff->use_mark[var] = eff->cur;
+  eff->use.push_back(var);
+}
+
+static void add_def(effects_t *eff, uint32_t var)
+{
+  if (var == SSA_NONE || eff->def_mark[var] == eff->cur) return;
+  eff->def_mark[var] = eff->cur;
+  eff->def.push_back(var);
+}
+
+static uint32_t symref_var(effects_t *eff, symref_t ref)
+{
+  return ssa_var_of(eff->ssa, ref.id);
+}
+
+static uint32_t reg_var(const ssa_t *ssa, int reg_id)
+{
+  return ssa_var_of(ssa, symbols_find_reg(ssa->symbols, reg_id).id);
+}
+
+static void value_use(effects_t *eff, value_t *v)
+{
+  switch (v->type) {
+    case VALUE_TYPE_SYM:
+      add_use(eff, symref_var(eff, v->u.sym->ref));
+      break;
+    case VALUE_TYPE_MEM:
+      add_use(eff, reg_var(eff->ssa, v->u.mem->sreg));
+      add_use(eff, reg_var(eff->ssa, v->u.mem->reg1));
+      add_use(eff, reg_var(eff->ssa, v->u.mem->reg2));
+      break;
+    default:
+      break;
+  }
+}
+
+static void value_def(effects_t *eff, value_t *v, bool also_reads)
+{
+  switch (v->type) {
+    case VALUE_TYPE_SYM: {
+      symref_t ref = v->u.sym->ref;
+      uint32_t var = symref_var(eff, ref);
+      bool partial = ref.off != 0 || ref.len != symbols_sym(eff->ssa->symbols, ref.id)->len;
+      if (also_reads || partial) add_use(eff, var);
+      add_def(eff, var);
+    } break;
+    case VALUE_TYPE_MEM:
+      // Storing through memory only reads the address registers
+      value_use(eff, v);
+      break;
+    default:
+      break;
+  }
+}
+
+static void all_vars(effects_t *eff, uint32_t first, uint32_t end, bool use, bool def)
+{
+  for (uint32_t var = first; var < end; var++) {
+    if (use) add_use(eff, var);
+    if (def) add_def(eff, var);
+  }
+}
+
+static void collect_effects(effects_t *eff, expr_t *expr, uint32_t n_regs, uint32_t flags_var,
+                            uint32_t sp_var, uint32_t bp_var)
+{
+  eff->use.clear();
+  eff->def.clear();
+
+  switch (expr->kind) {
+    case EXPR_KIND_UNKNOWN: {
+      all_vars(eff, 0, (uint32_t)eff->use_mark.size(), true, true);
+    } break;
+    case EXPR_KIND_OPERATOR1: {
+      value_def(eff, &expr->k.operator1->dest, true);
+    } break;
+    case EXPR_KIND_OPERATOR2: {
+      expr_operator2_t *k = expr->k.operator2;
+      value_use(eff, &k->src);
+      value_def(eff, &k->dest, 0 != strcmp(k->op.oper, "="));
+    } break;
+    case EXPR_KIND_OPERATOR3: {
+      expr_operator3_t *k = expr->k.operator3;
+      value_use(eff, &k->left);
+      value_use(eff, &k->right);
+      value_def(eff, &k->dest, false);
+    } break;
+    case EXPR_KIND_OPERATOR32: {
+      expr_operator32_t *k = expr->k.operator32;
+      for (size_t i = 0; i < 2; i++) {
+        value_use(eff, &k->left[i]);
+        value_use(eff, &k->right[i]);
+      }
+      for (size_t i = 0; i < 2; i++) value_def(eff, &k->dest[i], false);
+    } break;
+    case EXPR_KIND_ABSTRACT: {
+      expr_abstract_t *k = expr->k.abstract;
+      for (size_t i = 0; i < k->n_args; i++) value_use(eff, &k->args[i]);
+      if (!VALUE_IS_NONE(k->ret)) value_def(eff, &k->ret, false);
+    } break;
+    case EXPR_KIND_BRANCH_COND: {
+      value_use(eff, &expr->k.branch_cond->left);
+      value_use(eff, &expr->k.branch_cond->right);
+    } break;
+    case EXPR_KIND_BRANCH_FLAGS: {
+      value_use(eff, &expr->k.branch_flags->flags);
+    } break;
+    case EXPR_KIND_CALL: {
+      all_vars(eff, 0, n_regs, true, true);
+    } break;
+    case EXPR_KIND_CALL_WITH_ARGS: {
+      expr_call_with_args_t *k = expr->k.call_with_args;
+      for (size_t i = 0; i < (size_t)k->func->args; i++) value_use(eff, &k->args[i]);
+      all_vars(eff, 0, n_regs, true, true);
+    } break;
+    default:
+      break;
+  }
+
+  // Effects the operands don't spell out: the flags, the stack pointer and
+  // the string registers.
+  // Flags are only upward-exposed if the first instruction touching them
+  // reads them or only updates some of the status bits (a fused cmp+jcc
+  // consumes what it produced itself), and a
+  // compare-and-branch spells its condition out so never reads them at all.
+  bool flags_seen = expr->kind == EXPR_KIND_BRANCH_COND;
+  for (size_t i = 0; i < expr->n_ins; i++) {
+    operation_e op = expr->ins[i].opcode;
+    uint16_t written = instr_flags[size_t(op)].written;
+    bool reads   = instr_flags[size_t(op)].read != 0;
+    bool writes  = written != 0;
+    bool partial = writes && (written & FLAG_STATUS) != FLAG_STATUS; // e.g. INC keeps CF
+    if (!flags_seen && (reads || partial)) add_use(eff, flags_var);
+    if (reads || writes) flags_seen = true;
+    if (writes) add_def(eff, flags_var);
+
+    if (instr_moves_stack(op)) {
+      add_use(eff, sp_var);
+      add_def(eff, sp_var);
+    }
+    if (op == operation_e::ENTER || op == operation_e::LEAVE) {
+      add_use(eff, bp_var);
+      add_def(eff, bp_var);
+    }
+
+    // String instructions step SI/DI, and under rep count CX down
+    uint32_t steps = instr_regs[size_t(op)].def & (REG_BIT(REG_SI) | REG_BIT(REG_DI));
+    if (expr->ins[i].rep != REP_NONE) steps |= REG_BIT(REG_CX);
+    for (int r : {REG_SI, REG_DI, REG_CX}) {
+      if (!(steps & REG_BIT(r))) continue;
+      add_use(eff, reg_var(eff->ssa, r));
+      add_def(eff, reg_var(eff->ssa, r));
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Construction
+
+static inline bool bit_test(const uint64_t *set, uint32_t i) { return (set[i/64] >> (i%64)) & 1; }
+static inline void bit_set(uint64_t *set, uint32_t i)        { set[i/64] |= (uint64_t)1 << (i%64); }
+
+ssa_t * ssa_new(meh_t *m, symbols_t *symbols, const cfg_t *cfg, const dom_t *dom, dis86_instr_t *ins_base)
+{
+  assert(dom->cfg_version == cfg->version);
+
+  ssa_t *ssa = new ssa_t();
+  ssa->symbols = symbols;
+
+  const symtab_t *tabs[] = { symbols->registers, symbols->params, symbols->locals };
+  for (const symtab_t *t : tabs) {
+    for (size_t i = 0; i < t->n_var; i++) ssa->vars.push_back(&t->var[i]);
+  }
+
+  uint32_t n_vars   = (uint32_t)ssa->vars.size();
+  uint32_t n_regs   = (uint32_t)symbols->registers->n_var;
+  uint32_t n_blocks = cfg->n_blocks;
+  uint32_t n_expr   = (uint32_t)m->expr_len;
+  size_t   W        = (n_vars + 63) / 64;
+
+  for (uint32_t v = 0; v < n_vars; v++) {
+    ssa->defs.push_back({SSA_DEF_ENTRY, v, 0, 0});
+  }
+
+  // Uses and defs of every expression
+  effects_t eff[1];
+  eff->ssa = ssa;
+  eff->use_mark.assign(n_vars, SSA_NONE);
+  eff->def_mark.assign(n_vars, SSA_NONE);
+  uint32_t flags_var = reg_var(ssa, REG_FLAGS);
+  uint32_t sp_var    = reg_var(ssa, REG_SP);
+  uint32_t bp_var    = reg_var(ssa, REG_BP);
+
+  ssa->expr_block.resize(n_expr);
+  ssa->use_off.resize(n_expr+1);
+  ssa->def_off.resize(n_expr+1);
+  std::vector<uint32_t> block_expr_off(n_blocks+1, 0);
+  for (uint32_t e = 0; e < n_expr; e++) {
+    ssa->use_off[e] = (uint32_t)ssa->uses.size();
+    ssa->def_off[e] = (uint32_t)ssa->expr_defs.size();
+
+    expr_t *expr = &m->expr_arr[e];
+    if (!expr->n_ins) {
+      ssa->expr_block[e] = SSA_NONE;
+      continue;
+    }
+    uint32_t b = cfg->block_of[(expr->ins - ins_base) + expr->n_ins - 1];
+    ssa->expr_block[e] = b;
+    block_expr_off[b+1]++;
+
+    eff->cur = e;
+    collect_effects(eff, expr, n_regs, flags_var, sp_var, bp_var);
+    for (uint32_t var : eff->use) ssa->uses.push_back({var, SSA_NONE});
+    for (uint32_t var : eff->def) {
+      ssa->expr_defs.push_back((uint32_t)ssa->defs.size());
+      ssa->defs.push_back({SSA_DEF_EXPR, var, b, e});
+    }
+  }
+  ssa->use_off[n_expr] = (uint32_t)ssa->uses.size();
+  ssa->def_off[n_expr] = (uint32_t)ssa->expr_defs.size();
+
+  // Exprs are in address order, so each block's exprs are a contiguous run
+  for (uint32_t b = 0; b < n_blocks; b++) block_expr_off[b+1] += block_expr_off[b];
+  std::vector<uint32_t> block_expr(block_expr_off[n_blocks]);
+  {
+    std::vector<uint32_t> cursor(block_expr_off.begin(), block_expr_off.end() - 1);
+    for (uint32_t e = 0; e < n_expr; e++) {
+      uint32_t b = ssa->expr_block[e];
+      if (b != SSA_NONE) block_expr[cursor[b]++] = e;
+    }
+  }
+
+  // Liveness, only needed to prune the phis
+  std::vector<uint64_t> ue(n_blocks * W, 0), kill(n_blocks * W, 0), live_in(n_blocks * W, 0);
+  for (uint32_t b = 0; b < n_blocks; b++) {
+    for (uint32_t i = block_expr_off[b]; i < block_expr_off[b+1]; i++) {
+      uint32_t e = block_expr[i];
+      for (uint32_t u = ssa->use_off[e]; u < ssa->use_off[e+1]; u++) {
+        uint32_t var = ssa->uses[u].var;
+        if (!bit_test(&kill[b*W], var)) bit_set(&ue[b*W], var);
+      }
+      for (uint32_t d = ssa->def_off[e]; d < ssa->def_off[e+1]; d++) {
+        bit_set(&kill[b*W], ssa->defs[ssa->expr_defs[d]].var);
+      }
+    }
+  }
+  std::vector<uint64_t> out(W);
+  for (bool changed = true; changed; ) {
+    changed = false;
+    for (uint32_t i = dom->n_rpo; i-- > 0; ) {
+      uint32_t b = dom->rpo[i];
+      std::fill(out.begin(), out.end(), 0);
+      for (size_t j = 0; j < cfg_n_succ(cfg, b); j++) {
+        uint32_t s = cfg_succ(cfg, b)[j];
+        for (size_t w = 0; w < W; w++) out[w] |= live_in[s*W + w];
+      }
+      for (size_t w = 0; w < W; w++) {
+        uint64_t in = ue[b*W + w] | (out[w] & ~kill[b*W + w]);
+        if (in != live_in[b*W + w]) {
+          live_in[b*W + w] = in;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  // Dominance frontiers (Cooper-Harvey-Kennedy runner walk), CSR
+  std::vector<uint32_t> df_off(n_blocks+1, 0), df;
+  {
+    std::vector<uint32_t> stamp(n_blocks, SSA_NONE);
+    auto walk = [&](bool fill) {
+      std::fill(stamp.begin(), stamp.end(), SSA_NONE);
+      std::vector<uint32_t> cursor;
+      if (fill) cursor.assign(df_off.begin(), df_off.end() - 1);
+      for (uint32_t b = 0; b < n_blocks; b++) {
+        if (!dom_reachable(dom, b) || cfg_n_pred(cfg, b) < 2) continue;
+        for (size_t j = 0; j < cfg_n_pred(cfg, b); j++) {
+          uint32_t runner = cfg_pred(cfg, b)[j];
+          if (!dom_reachable(dom, runner)) continue;
+          while (runner != dom->idom[b] && stamp[runner] != b) {
+            stamp[runner] = b;
+            if (fill) df[cursor[runner]++] = b;
+            else      df_off[runner+1]++;
+            runner = dom->idom[runner];
+          }
+        }
+      }
+    };
+    walk(false);
+    for (uint32_t b = 0; b < n_blocks; b++) df_off[b+1] += df_off[b];
+    df.resize(df_off[n_blocks]);
+    walk(true);
+  }
+
+  // Pruned phi placement over the iterated dominance frontier of each
+  // variable's def blocks (the entry block counts as a def of everything)
+  std::vector<uint32_t> dblk_off(n_vars+1, 0), dblk;
+  for (uint32_t d = n_vars; d < ssa->defs.size(); d++) dblk_off[ssa->defs[d].var+1]++;
+  for (uint32_t v = 0; v < n_vars; v++) dblk_off[v+1] += dblk_off[v];
+  dblk.resize(dblk_off[n_vars]);
+  {
+    std::vector<uint32_t> cursor(dblk_off.begin(), dblk_off.end() - 1);
+    for (uint32_t d = n_vars; d < ssa->defs.size(); d++) dblk[cursor[ssa->defs[d].var]++] = ssa->defs[d].block;
+  }
+
+  std::vector<std::pair<uint32_t, uint32_t>> placed; // (block, var)
+  {
+    std::vector<uint32_t> has_phi(n_blocks, SSA_NONE), in_work(n_blocks, SSA_NONE), work;
+    for (uint32_t v = 0; v < n_vars; v++) {
+      if (n_blocks) {
+        in_work[0] = v;
+        work.push_back(0);
+      }
+      for (uint32_t i = dblk_off[v]; i < dblk_off[v+1]; i++) {
+        uint32_t b = dblk[i];
+        if (in_work[b] == v) continue;
+        in_work[b] = v;
+        work.push_back(b);
+      }
+      while (!work.empty()) {
+        uint32_t x = work.back();
+        work.pop_back();
+        for (uint32_t i = df_off[x]; i < df_off[x+1]; i++) {
+          uint32_t y = df[i];
+          if (has_phi[y] == v || !bit_test(&live_in[y*W], v)) continue;
+          has_phi[y] = v;
+          placed.push_back({y, v});
+          if (in_work[y] != v) {
+            in_work[y] = v;
+            work.push_back(y);
+          }
+        }
+      }
+    }
+  }
+  std::sort(placed.begin(), placed.end());
+
+  ssa->block_phi_off.assign(n_blocks+1, 0);
+  for (auto& [b, v] : placed) {
+    ssa_phi_t phi = {v, b, (uint32_t)ssa->defs.size(), (uint32_t)ssa->phi_args.size()};
+    ssa->defs.push_back({SSA_DEF_PHI, v, b, (uint32_t)ssa->phis.size()});
+    ssa->phis.push_back(phi);
+    ssa->phi_args.resize(ssa->phi_args.size() + cfg_n_pred(cfg, b), SSA_NONE);
+    ssa->block_phi_off[b+1]++;
+  }
+  for (uint32_t b = 0; b < n_blocks; b++) ssa->block_phi_off[b+1] += ssa->block_phi_off[b];
+
+  // Renaming: walk the dominator tree keeping the current def of each
+  // variable, with an undo log to restore it when leaving a subtree
+  if (n_blocks) {
+    std::vector<uint32_t> cur(n_vars);
+    for (uint32_t v = 0; v < n_vars; v++) cur[v] = v;
+    std::vector<std::pair<uint32_t, uint32_t>> undo; // (var, previous def)
+
+    struct frame { uint32_t block; uint32_t mark; bool leaving; };
+    std::vector<frame> stack;
+    stack.push_back({0, 0, false});
+    while (!stack.empty()) {
+      frame f = stack.back();
+      stack.pop_back();
+      uint32_t b = f.block;
+
+      if (f.leaving) {
+        while (undo.size() > f.mark) {
+          cur[undo.back().first] = undo.back().second;
+          undo.pop_back();
+        }
+        continue;
+      }
+
+      stack.push_back({b, (uint32_t)undo.size(), true});
+
+      for (uint32_t p = ssa->block_phi_off[b]; p < ssa->block_phi_off[b+1]; p++) {
+        ssa_phi_t *phi = &ssa->phis[p];
+        undo.push_back({phi->var, cur[phi->var]});
+        cur[phi->var] = phi->def;
+      }
+      for (uint32_t i = block_expr_off[b]; i < block_expr_off[b+1]; i++) {
+        uint32_t e = block_expr[i];
+        for (uint32_t u = ssa->use_off[e]; u < ssa->use_off[e+1]; u++) {
+          ssa->uses[u].def = cur[ssa->uses[u].var];
+        }
+        for (uint32_t d = ssa->def_off[e]; d < ssa->def_off[e+1]; d++) {
+          uint32_t def = ssa->expr_defs[d];
+          undo.push_back({ssa->defs[def].var, cur[ssa->defs[def].var]});
+          cur[ssa->defs[def].var] = def;
+        }
+      }
+      for (size_t j = 0; j < cfg_n_succ(cfg, b); j++) {
+        uint32_t s = cfg_succ(cfg, b)[j];
+        size_t k = 0;
+        while (cfg_pred(cfg, s)[k] != b) k++;
+        for (uint32_t p = ssa->block_phi_off[s]; p < ssa->block_phi_off[s+1]; p++) {
+          ssa_phi_t *phi = &ssa->phis[p];
+          ssa->phi_args[phi->arg_off + k] = cur[phi->var];
+        }
+      }
+      for (uint32_t c = dom->child_off[b]; c < dom->child_off[b+1]; c++) {
+        stack.push_back({dom->child[c], 0, false});
+      }
+    }
+  }
+
+  // Def-use chains
+  uint32_t n_defs = (uint32_t)ssa->defs.size();
+  ssa->du_off.assign(n_defs+1, 0);
+  for (auto& u : ssa->uses) {
+    if (u.def != SSA_NONE) ssa->du_off[u.def+1]++;
+  }
+  for (uint32_t arg : ssa->phi_args) {
+    if (arg != SSA_NONE) ssa->du_off[arg+1]++;
+  }
+  for (uint32_t d = 0; d < n_defs; d++) ssa->du_off[d+1] += ssa->du_off[d];
+  ssa->du.resize(ssa->du_off[n_defs]);
+  {
+    std::vector<uint32_t> cursor(ssa->du_off.begin(), ssa->du_off.end() - 1);
+    for (uint32_t e = 0; e < n_expr; e++) {
+      for (uint32_t u = ssa->use_off[e]; u < ssa->use_off[e+1]; u++) {
+        uint32_t def = ssa->uses[u].def;
+        if (def != SSA_NONE) ssa->du[cursor[def]++] = {e, false};
+      }
+    }
+    for (uint32_t p = 0; p < ssa->phis.size(); p++) {
+      ssa_phi_t *phi = &ssa->phis[p];
+      for (size_t k = 0; k < cfg_n_pred(cfg, phi->block); k++) {
+        uint32_t def = ssa->phi_args[phi->arg_off + k];
+        if (def != SSA_NONE) ssa->du[cursor[def]++] = {p, true};
+      }
+    }
+  }
+
+  return ssa;
+}
+
+void ssa_delete(ssa_t *ssa)
+{
+  delete ssa;
+}
+
+static std::string def_str(ssa_t *ssa, uint32_t def)
+{
+  if (def == SSA_NONE) return "?";
+  return sym_name(ssa->vars[ssa->defs[def].var]) + "." + std::to_string(def);
+}
+
+void ssa_dump(ssa_t *ssa, meh_t *m)
+{
+  uint32_t n_blocks = (uint32_t)ssa->block_phi_off.size() - 1;
+  for (uint32_t b = 0; b < n_blocks; b++) {
+    for (uint32_t p = ssa->block_phi_off[b]; p < ssa->block_phi_off[b+1]; p++) {
+      ssa_phi_t *phi = &ssa->phis[p];
+      std::string s = def_str(ssa, phi->def) + " = phi(";
+      uint32_t n_args = (p+1 < ssa->phis.size() ? ssa->phis[p+1].arg_off : (uint32_t)ssa->phi_args.size()) - phi->arg_off;
+      for (uint32_t k = 0; k < n_args; k++) {
+        if (k) s += ", ";
+        s += def_str(ssa, ssa->phi_args[phi->arg_off + k]);
+      }
+      fprintf(stderr, "  block %-5u | %s) | %zu users\n", b, s.c_str(), ssa_n_users(ssa, phi->def));
+    }
+  }
+  for (uint32_t e = 0; e < m->expr_len; e++) {
+    if (ssa->expr_block[e] == SSA_NONE) continue;
+    std::string s;
+    for (uint32_t u = ssa->use_off[e]; u < ssa->use_off[e+1]; u++) s += " " + def_str(ssa, ssa->uses[u].def);
+    s += " ->";
+    for (uint32_t d = ssa->def_off[e]; d < ssa->def_off[e+1]; d++) s += " " + def_str(ssa, ssa->expr_defs[d]);
+    fprintf(stderr, "  expr  %-5u | block %-5u |%s\n", e, ssa->expr_block[e], s.c_str());
+  }
+}
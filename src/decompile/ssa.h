@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <unistd.h>
+#include <vector>
+
+#include "symbols.h"
+#include "expr.h"
+#include "cfg.h"
+#include "dom.h"
+
+// SSA form over the expression IR
+//
+// The expressions themselves are left untouched: SSA is an overlay that
+// numbers every definition of a variable and links each use to the single
+// definition reaching it. Variables are the non-global symbols: registers
+// (FLAGS included), params and locals. Globals and raw memory are not
+// tracked.
+//
+// Each expression belongs to the block of its last instruction. Within an
+// expression all uses happen before all defs, and a partial write (AL into
+// AX) counts as a use and a def of the whole variable. Calls read and write
+// every register and UNKNOWN expressions read and write everything.
+//
+// Phis are pruned: one is only placed where the variable is live on entry.
+// Def 'v' for v < n_vars is the value variable v holds on function entry.
+
+#define SSA_NONE UINT32_MAX
+
+enum {
+  SSA_DEF_ENTRY,
+  SSA_DEF_EXPR,
+  SSA_DEF_PHI,
+};
+
+struct ssa_def_t
+{
+  int      kind;   /* SSA_DEF_* */
+  uint32_t var;
+  uint32_t block;
+  uint32_t site;   /* expr index or phi index, unused for entry defs */
+};
+
+struct ssa_phi_t
+{
+  uint32_t var;
+  uint32_t block;
+  uint32_t def;
+  uint32_t arg_off;  /* phi_args[arg_off + k] flows in from cfg_pred(block)[k] */
+};
+
+struct ssa_use_t
+{
+  uint32_t var;
+  uint32_t def;      /* SSA_NONE in unreachable code */
+};
+
+struct ssa_user_t
+{
+  uint32_t site;     /* expr index or phi index */
+  bool     is_phi;
+};
+
+struct ssa_t
+{
+  symbols_t *             symbols;
+  std::vector<const sym_t*> vars;         /* registers, then params, then locals */
+
+  std::vector<ssa_def_t>  defs;
+  std::vector<ssa_phi_t>  phis;           /* ordered by block */
+  std::vector<uint32_t>   phi_args;
+  std::vector<uint32_t>   block_phi_off;  /* phis of block b: [block_phi_off[b], block_phi_off[b+1]) */
+
+  std::vector<uint32_t>   expr_block;     /* SSA_NONE for exprs with no instructions */
+  std::vector<uint32_t>   use_off;        /* per expr, CSR into uses */
+  std::vector<ssa_use_t>  uses;
+  std::vector<uint32_t>   def_off;        /* per expr, CSR into expr_defs */
+  std::vector<uint32_t>   expr_defs;
+
+  std::vector<uint32_t>   du_off;         /* per def, CSR into du */
+  std::vector<ssa_user_t> du;
+};
+
+ssa_t * ssa_new(meh_t *m, symbols_t *symbols, const cfg_t *cfg, const dom_t *dom, dis86_instr_t *ins_base);
+void    ssa_delete(ssa_t *ssa);
+void    ssa_dump(ssa_t *ssa, meh_t *m);
+
+uint32_t ssa_var_of(const ssa_t *ssa, sym_id_t id);  /* SSA_NONE for globals */
+uint32_t ssa_reaching_def(const ssa_t *ssa, size_t expr_idx, uint32_t var);  /* SSA_NONE if expr doesn't use var */
+uint32_t ssa_expr_def(const ssa_t *ssa, size_t expr_idx, uint32_t var);      /* SSA_NONE if expr doesn't define var */
+
+static inline size_t ssa_n_vars(const ssa_t *ssa) { return ssa->vars.size(); }
+static inline size_t ssa_n_users(const ssa_t *ssa, uint32_t def) { return ssa->du_off[def+1] - ssa->du_off[def]; }
+static inline const ssa_user_t * ssa_users(const ssa_t *ssa, uint32_t def) { return ssa->du.data() + ssa->du_off[def]; }
@@ -1,6 +1,7 @@
 #include "decompile_private.h"
 #include <stdalign.h>
 
+#include <algorithm>
 #include <format>
 #include <string>
 
@@ -49,48 +50,22 @@ bool sym_deduce(sym_t *s, operand_mem_t *m)
 
 bool sym_deduce_reg(sym_t *sym, int reg_id)
 {
-  uint16_t off, len;
-  const char *name;
-
-  switch (reg_id) {
-    case REG_AX:    off =  0; len = 2; name = "AX";    break;
-    case REG_CX:    off =  2; len = 2; name = "CX";    break;
-    case REG_DX:    off =  4; len = 2; name = "DX";    break;
-    case REG_BX:    off =  6; len = 2; name = "BX";    break;
-    case REG_SP:    off =  8; len = 2; name = "SP";    break;
-    case REG_BP:    off = 10; len = 2; name = "BP";    break;
-    case REG_SI:    off = 12; len = 2; name = "SI";    break;
-    case REG_DI:    off = 14; len = 2; name = "DI";    break;
-    case REG_AL:    off =  0; len = 1; name = "AL";    break;
-    case REG_CL:    off =  2; len = 1; name = "CL";    break;
-    case REG_DL:    off =  4; len = 1; name = "DL";    break;
-    case REG_BL:    off =  6; len = 1; name = "BL";    break;
-    case REG_AH:    off =  1; len = 1; name = "AH";    break;
-    case REG_CH:    off =  3; len = 1; name = "CH";    break;
-    case REG_DH:    off =  5; len = 1; name = "DH";    break;
-    case REG_BH:    off =  7; len = 1; name = "CH";    break;
-    case REG_ES:    off = 16; len = 2; name = "ES";    break;
-    case REG_CS:    off = 18; len = 2; name = "CS";    break;
-    case REG_SS:    off = 20; len = 2; name = "SS";    break;
-    case REG_DS:    off = 22; len = 2; name = "DS";    break;
-    case REG_IP:    off = 24; len = 2; name = "IP";    break;
-    case REG_FLAGS: off = 26; len = 2; name = "FLAGS"; break;
-    default: return false;
-  }
+  if (reg_id <= REG_INVAL || reg_id >= _REG_LAST) return false;
 
+  const reg_info_t& r = reg_info[reg_id];
   sym->kind = SYM_KIND_REGISTER;
-  sym->off  = (int16_t)off;
-  sym->len  = len;
-  sym->name = name;
+  sym->off  = (int16_t)r.off;
+  sym->len  = r.bits / 8;
+  sym->name = reg_name_upper(reg_id);
   return true;
 }
 
-size_t sym_size_bytes(sym_t *s)
+size_t sym_size_bytes(const sym_t *s)
 {
   return s->len;
 }
 
-std::string sym_name(sym_t *sym)
+std::string sym_name(const sym_t *sym)
 {
   if (sym->name) {
     return sym->name;
@@ -99,13 +74,13 @@ std::string sym_name(sym_t *sym)
 
   switch (sym->kind) {
     case SYM_KIND_PARAM:
-      s += std::format<"_param_%04x">((uint16_t)sym->off);
+      std::format_to<"_param_%04x">(std::back_inserter(s), (uint16_t)sym->off);
       break;
     case SYM_KIND_LOCAL:
-      s += std::format<"_local_%04x">((uint16_t)-sym->off);
+      std::format_to<"_local_%04x">(std::back_inserter(s), (uint16_t)-sym->off);
       break;
     case SYM_KIND_GLOBAL:
-      s += std::format<"G_data_%04x">((uint16_t)sym->off);
+      std::format_to<"G_data_%04x">(std::back_inserter(s), (uint16_t)sym->off);
       break;
     default:
       FAIL("Unknown sym kind: %d", sym->kind);
@@ -113,11 +88,11 @@ std::string sym_name(sym_t *sym)
   return s;
 }
 
-static bool sym_overlaps(sym_t *a, sym_t *b)
+static bool sym_overlaps(const sym_t *a, const sym_t *b)
 {
   // WLOG: Let a->off <= b->off
   if (b->off < a->off) {
-    sym_t *tmp = a;
+    const sym_t *tmp = a;
     a = b;
     b = tmp;
   }
@@ -129,22 +104,158 @@ static bool sym_overlaps(sym_t *a, sym_t *b)
     b->off < end;
 }
 
-symbols_t * symbols_new(void)
+// The 16-bit registers as symbols, and what every register id resolves to
+// in terms of them (the 8-bit ones are a byte of their parent)
+struct register_file_t
+{
+  symtab_t * tab;
+  symref_t   ref[_REG_LAST];
+};
+
+static const register_file_t * register_file(void)
+{
+  static const register_file_t *file = [] {
+    register_file_t *f = (register_file_t*)calloc(1, sizeof(register_file_t));
+    f->tab = symtab_new();
+
+    size_t idx[_REG_LAST] = {};
+    for (int reg_id = 1; reg_id < _REG_LAST; reg_id++) {
+      if (reg_info[reg_id].parent != reg_id) continue; // skip the small overlap regs
+      idx[reg_id] = f->tab->n_var;
+      sym_deduce_reg(&f->tab->var[f->tab->n_var++], reg_id);
+    }
+
+    for (int reg_id = 1; reg_id < _REG_LAST; reg_id++) {
+      const reg_info_t& r = reg_info[reg_id];
+      const reg_info_t& p = reg_info[r.parent];
+      f->ref[reg_id].id  = SYM_ID(SYM_KIND_REGISTER, idx[r.parent]);
+      f->ref[reg_id].off = r.off - p.off;
+      f->ref[reg_id].len = r.bits / 8;
+    }
+    return f;
+  }();
+  return file;
+}
+
+const symtab_t * symtab_registers(void)
+{
+  return register_file()->tab;
+}
+
+symtab_shared_t * symtab_shared_new(dis86_decompile_config_t *cfg)
+{
+  std::vector<sym_t>  syms;
+  std::vector<size_t> idx;
+  for (size_t i = 0; i < cfg->global_len; i++) {
+    config_global_t *cg = &cfg->global_arr[i];
+
+    type_t type[1];
+    if (!type_parse(type, cg->type)) {
+      LOG_WARN("For global '%s', failed to parse type '%s' ... skipping", cg->name, cg->type);
+      continue;
+    }
+
+    sym_t sym[1] = {{}};
+    sym->kind = SYM_KIND_GLOBAL;
+    sym->off  = (int16_t)cg->offset;
+    sym->len  = type_size(type);
+    sym->name = cg->name;
+    syms.push_back(*sym);
+    idx.push_back(i);
+  }
+
+  symtab_shared_t *g = (symtab_shared_t*)calloc(1, sizeof(symtab_shared_t));
+  if (syms.size() > ARRAY_SIZE(g->tab.var)) {
+    free(g);
+    FAIL("Too many globals (max %zu)", ARRAY_SIZE(g->tab.var));
+  }
+
+  // Sort by offset, keeping config order among equal offsets
+  std::vector<size_t> order(syms.size());
+  for (size_t i = 0; i < order.size(); i++) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return syms[a].off < syms[b].off; });
+
+  g->refs = 1;
+  g->cfg_idx = (size_t*)calloc(order.size() ? order.size() : 1, sizeof(size_t));
+  for (size_t i = 0; i < order.size(); i++) {
+    sym_t *sym = &g->tab.var[i];
+    *sym = syms[order[i]];
+    sym->name = strdup(sym->name);
+    g->cfg_idx[i] = idx[order[i]];
+    g->max_len = MAX(g->max_len, sym->len);
+  }
+  g->tab.n_var = order.size();
+  return g;
+}
+
+symtab_shared_t * symtab_shared_ref(symtab_shared_t *g)
+{
+  g->refs.fetch_add(1, std::memory_order_relaxed);
+  return g;
+}
+
+void symtab_shared_unref(symtab_shared_t *g)
+{
+  if (!g) return;
+  if (g->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+  for (size_t i = 0; i < g->tab.n_var; i++) free((char*)g->tab.var[i].name);
+  free(g->cfg_idx);
+  free(g);
+}
+
+size_t symtab_shared_lower(const symtab_shared_t *g, int off)
+{
+  const sym_t *var = g->tab.var;
+  return std::lower_bound(var, var + g->tab.n_var, off,
+                          [](const sym_t& s, int o) { return s.off < o; }) - var;
+}
+
+static symtab_t * symtab_new_in(arena_t *a)
+{
+  // Only the count needs clearing: entries past n_var are never read
+  symtab_t *s = (symtab_t*)arena_alloc(a, sizeof(symtab_t), alignof(symtab_t));
+  s->n_var = 0;
+  return s;
+}
+
+symbols_t * symbols_new(symtab_shared_t *globals, arena_t *opt_arena)
 {
-  symbols_t *s = (symbols_t*)calloc(1, sizeof(symbols_t));
-  s->registers = symtab_new();
-  s->globals   = symtab_new();
-  s->params    = symtab_new();
-  s->locals    = symtab_new();
+  symbols_t *s = opt_arena ? arena_calloc<symbols_t>(opt_arena, 1) : (symbols_t*)calloc(1, sizeof(symbols_t));
+  s->registers = symtab_registers();
+  s->shared    = symtab_shared_ref(globals);
+  s->globals   = &globals->tab;
+  s->params    = opt_arena ? symtab_new_in(opt_arena) : symtab_new();
+  s->locals    = opt_arena ? symtab_new_in(opt_arena) : symtab_new();
+  s->arena     = opt_arena;
   return s;
 }
 
 void symbols_delete(symbols_t *s)
 {
-  symtab_delete(s->registers);
-  symtab_delete(s->globals);
+  symtab_shared_unref(s->shared);
+  if (s->arena) return;
   symtab_delete(s->params);
   symtab_delete(s->locals);
+  free(s);
+}
+
+static symtab_t * symtab_copy(const symtab_t *t)
+{
+  symtab_t *s = (symtab_t*)malloc(offsetof(symtab_t, var) + (t->n_var ? t->n_var : 1) * sizeof(sym_t));
+  s->n_var = t->n_var;
+  memcpy(s->var, t->var, t->n_var * sizeof(sym_t));
+  return s;
+}
+
+symbols_t * symbols_copy(const symbols_t *s)
+{
+  symbols_t *c = (symbols_t*)calloc(1, sizeof(symbols_t));
+  c->registers = s->registers;
+  c->shared    = symtab_shared_ref(s->shared);
+  c->globals   = s->globals;
+  c->params    = symtab_copy(s->params);
+  c->locals    = symtab_copy(s->locals);
+  return c;
 }
 
 symtab_t * symtab_new(void)
@@ -179,48 +290,73 @@ static void symtab_add_merge(symtab_t *s, sym_t *sym)
     // Remove the candidate (avoid duplicates)
     s->var[i] = s->var[--s->n_var];
     i--;
+    STAT_INC(SYMBOLS_MERGED);
   }
 
-  assert(s->n_var < ARRAY_SIZE(s->var));
+  if (s->n_var >= ARRAY_SIZE(s->var)) FAIL("Too many symbols (max %zu)", ARRAY_SIZE(s->var));
   s->var[s->n_var++] = *sym;
 }
 
-static symref_t symtab_find(symtab_t *s, sym_t *deduced_sym)
+static symref_t symtab_find(const symtab_t *s, sym_t *deduced_sym)
 {
   symref_t ref = {};
 
   for (size_t i = 0; i < s->n_var; i++) {
-    sym_t *cand = &s->var[i];
+    const sym_t *cand = &s->var[i];
     if (sym_overlaps(deduced_sym, cand)) {
       assert(cand->off <= deduced_sym->off);
-      ref.symbol = cand;
-      ref.off    = deduced_sym->off - cand->off;
-      ref.len    = deduced_sym->len;
+      ref.id  = SYM_ID(cand->kind, i);
+      ref.off = deduced_sym->off - cand->off;
+      ref.len = deduced_sym->len;
       break;
     }
   }
 
+  if (!ref.id) STAT_INC(SYMBOLS_LOOKUP_MISS);
+  return ref;
+}
+
+static symref_t globals_find(const symtab_shared_t *g, sym_t *deduced_sym)
+{
+  symref_t ref = {};
+
+  // Only entries starting within max_len below the access can reach it. Of
+  // those, the first one configured wins, as it would in a linear scan.
+  size_t best = SIZE_MAX;
+  for (size_t i = symtab_shared_lower(g, deduced_sym->off - g->max_len + 1); i < g->tab.n_var; i++) {
+    const sym_t *cand = &g->tab.var[i];
+    if (cand->off >= deduced_sym->off + deduced_sym->len) break;
+    if (!sym_overlaps(deduced_sym, cand)) continue;
+    if (ref.id && g->cfg_idx[i] > best) continue;
+    assert(cand->off <= deduced_sym->off);
+    best    = g->cfg_idx[i];
+    ref.id  = SYM_ID(SYM_KIND_GLOBAL, i);
+    ref.off = deduced_sym->off - cand->off;
+    ref.len = deduced_sym->len;
+  }
+
+  if (!ref.id) STAT_INC(SYMBOLS_LOOKUP_MISS);
   return ref;
 }
 
 typedef struct iter_impl iter_impl_t;
 struct __attribute__((aligned(16))) iter_impl
 {
-  symtab_t * s;
-  size_t     idx;
+  const symtab_t * s;
+  size_t           idx;
   char       _extra[16];
 };
 static_assert(sizeof(iter_impl_t) == sizeof(symtab_iter_t), "");
 static_assert(alignof(iter_impl_t) == alignof(symtab_iter_t), "");
 
-void symtab_iter_begin(symtab_iter_t *_it, symtab_t *s)
+void symtab_iter_begin(symtab_iter_t *_it, const symtab_t *s)
 {
   iter_impl_t *it = (iter_impl_t*)_it;
   it->s = s;
   it->idx = 0;
 }
 
-sym_t * symtab_iter_next(symtab_iter_t *_it)
+const sym_t * symtab_iter_next(symtab_iter_t *_it)
 {
   iter_impl_t *it = (iter_impl_t*)_it;
   if (it->idx >= it->s->n_var) return nullptr;
@@ -230,15 +366,19 @@ sym_t * symtab_iter_next(symtab_iter_t *_it)
 bool symbols_insert_deduced(symbols_t *s, sym_t *deduced_sym)
 {
   switch (deduced_sym->kind) {
-    case SYM_KIND_REGISTER: symtab_add_merge(s->registers, deduced_sym); break;
+    case SYM_KIND_REGISTER: {
+      // Registers are fixed: every one of them is already in the table
+      symref_t ref = symtab_find(s->registers, deduced_sym);
+      if (!ref.id) return false;
+    } break;
     case SYM_KIND_PARAM:    symtab_add_merge(s->params,    deduced_sym); break;
     case SYM_KIND_LOCAL:    symtab_add_merge(s->locals,    deduced_sym); break;
     case SYM_KIND_GLOBAL: {
       // Globals are special in that we don't merge them in. We require that globals
       // are set up via a config file. So, here, we simply verify that our deduced
       // symbol cooresponds to some pre-configured global
-      symref_t ref = symtab_find(s->globals, deduced_sym);
-      if (!ref.symbol) {
+      symref_t ref = globals_find(s->shared, deduced_sym);
+      if (!ref.id) {
         //const char *name = sym_name(deduced_sym);
         //FAIL("Failed to find global for '%s'", name);
         return false;
@@ -256,7 +396,7 @@ symref_t symbols_find_ref(symbols_t *s, sym_t *deduced_sym)
     case SYM_KIND_REGISTER: return symtab_find(s->registers, deduced_sym);
     case SYM_KIND_PARAM:    return symtab_find(s->params,    deduced_sym);
     case SYM_KIND_LOCAL:    return symtab_find(s->locals,    deduced_sym);
-    case SYM_KIND_GLOBAL:   return symtab_find(s->globals,   deduced_sym);
+    case SYM_KIND_GLOBAL:   return globals_find(s->shared,   deduced_sym);
     default: FAIL("Unknown symbol kind: %d", deduced_sym->kind);
   }
 }
@@ -273,31 +413,19 @@ symref_t symbols_find_mem(symbols_t *s, operand_mem_t *mem)
 
 symref_t symbols_find_reg(symbols_t *s, int reg_id)
 {
-  sym_t deduced_sym[1];
-  if (!sym_deduce_reg(deduced_sym, reg_id)) {
+  // Registers are the same for every function: no search needed
+  assert(s->registers == symtab_registers());
+  if (reg_id <= REG_INVAL || reg_id >= _REG_LAST) {
     symref_t ref = {};
     return ref;
   }
-  return symbols_find_ref(s, deduced_sym);
-}
-
-void symbols_add_global(symbols_t *s, const char *name, uint16_t offset, uint16_t len)
-{
-  sym_t sym[1] = {{}};
-  sym->kind = SYM_KIND_GLOBAL;
-  sym->off  = (int16_t)offset;
-  sym->len  = len;
-  sym->name = name;
-
-  symtab_t *symtab = s->globals;
-  assert(symtab->n_var < ARRAY_SIZE(symtab->var));
-  symtab->var[symtab->n_var++] = *sym;
+  return register_file()->ref[reg_id];
 }
 
 bool symref_matches(symref_t *a, symref_t *b)
 {
   return
-    a->symbol == b->symbol &&
+    a->id == b->id &&
     a->off == b->off &&
     a->len == b->len;
 }
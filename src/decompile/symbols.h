@@ -1,11 +1,12 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <unistd.h>
 #include <string>
 
-#define NAME_MAX 128
 
+typedef struct arena arena_t;
 
 struct __attribute__((aligned(16))) symtab_iter_t { char _opaque[32]; };
 
@@ -34,39 +35,94 @@ struct symtab_t
   sym_t var[SYMTAB_MAX_SIZE];
 };
 
+// Symbols are referred to by id: the kind in the top byte and the index in
+// that kind's table below it. Ids stay valid when the tables are copied (see
+// symbols_copy) and compare as plain integers.
+typedef uint32_t sym_id_t;
+
+#define SYM_ID_NONE         ((sym_id_t)0)
+#define SYM_ID(kind, idx)   ((sym_id_t)((kind) + 1) << 24 | (sym_id_t)(idx))
+#define SYM_ID_KIND(id)     ((int)((id) >> 24) - 1)
+#define SYM_ID_INDEX(id)    ((size_t)((id) & 0xffffff))
+
 struct symref_t
 {
-  sym_t * symbol;  // nullptr if the ref doesn't point anywhere
-  uint16_t     off;     // offset into this symbol
-  uint16_t     len;     // length from the offset
+  sym_id_t id;   // SYM_ID_NONE if the ref doesn't point anywhere
+  uint16_t off;  // offset into this symbol
+  uint16_t len;  // length from the offset
 };
+static_assert(sizeof(symref_t) == 8, "");
 
 
 bool         sym_deduce(sym_t *v, operand_mem_t *mem);
 bool         sym_deduce_reg(sym_t *sym, int reg_id);
-std::string sym_name(sym_t *v);
-size_t       sym_size_bytes(sym_t *v);
+std::string sym_name(const sym_t *v);
+size_t       sym_size_bytes(const sym_t *v);
+
+// The globals of a config as symbols, sorted by offset. Built once per config
+// and only read after that, so every function decompiled under the config
+// (from any thread) shares it. It owns copies of the names and is reference
+// counted, so cached results can keep the table they were built against
+// after the config itself is reloaded.
+struct symtab_shared_t
+{
+  std::atomic<size_t> refs;
+  uint16_t            max_len;  // longest global: bounds the search for overlaps
+  size_t *            cfg_idx;  // config global each entry was built from
+  symtab_t            tab;
+};
+
+symtab_shared_t * symtab_shared_new(dis86_decompile_config_t *cfg);
+symtab_shared_t * symtab_shared_ref(symtab_shared_t *g);
+void              symtab_shared_unref(symtab_shared_t *g);
+
+/* Index of the first entry at or after 'off': entries that can overlap
+   [lo, hi) start from symtab_shared_lower(g, lo - g->max_len + 1) */
+size_t            symtab_shared_lower(const symtab_shared_t *g, int off);
+
+/* The 16-bit registers, the same for every function */
+const symtab_t *  symtab_registers(void);
 
 struct symbols_t
 {
-  symtab_t * registers;
-  symtab_t * globals;
-  symtab_t * params;
-  symtab_t * locals;
+  const symtab_t *  registers;  // symtab_registers()
+  const symtab_t *  globals;    // shared->tab
+  symtab_shared_t * shared;     // a reference, released with the symbols
+  symtab_t *        params;
+  symtab_t *        locals;
+  arena_t *         arena;      // holds all of the above if set
 };
 
-symbols_t * symbols_new(void);
+/* With an arena the tables are carved from it and symbols_delete() only drops
+   the globals reference: the rest goes when the arena is reset */
+symbols_t * symbols_new(symtab_shared_t *globals, arena_t *opt_arena);
 void        symbols_delete(symbols_t *s);
+
+/* Heap copy with the params and locals trimmed to size, for keeping past the
+   arena. Refs into 's' resolve the same in the copy. */
+symbols_t * symbols_copy(const symbols_t *s);
 bool        symbols_insert_deduced(symbols_t *s, sym_t *deduced_sym);
 symref_t    symbols_find_ref(symbols_t *s, sym_t *deduced_sym);
 symref_t    symbols_find_mem(symbols_t *s, operand_mem_t *mem);
 symref_t    symbols_find_reg(symbols_t *s, int reg_id);
-void        symbols_add_global(symbols_t *s, const char *name, uint16_t offset, uint16_t len);
+
+static inline const sym_t * symbols_sym(const symbols_t *s, sym_id_t id)
+{
+  const symtab_t *tab = nullptr;
+  switch (SYM_ID_KIND(id)) {
+    case SYM_KIND_REGISTER: tab = s->registers; break;
+    case SYM_KIND_PARAM:    tab = s->params;    break;
+    case SYM_KIND_LOCAL:    tab = s->locals;    break;
+    case SYM_KIND_GLOBAL:   tab = s->globals;   break;
+    default:                return nullptr;
+  }
+  return &tab->var[SYM_ID_INDEX(id)];
+}
 
 bool symref_matches(symref_t *a, symref_t *b);
 
 symtab_t * symtab_new(void);
 void       symtab_delete(symtab_t *s);
 
-void    symtab_iter_begin(symtab_iter_t *it, symtab_t *s);
-sym_t * symtab_iter_next(symtab_iter_t *it);
+void    symtab_iter_begin(symtab_iter_t *it, const symtab_t *s);
+const sym_t * symtab_iter_next(symtab_iter_t *it);
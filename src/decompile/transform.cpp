@@ -15,22 +15,30 @@ void transform_pass_xor_rr(meh_t *m)
     // Rewrite
     k->op.oper = "=";
     k->src = VALUE_IMM(0);
+    STAT_INC(FUSED_XOR_RR);
   }
 }
 
+static bool try_jump_operation(const char *op, operator_t *o)
+{
+  *o = {};
+  if (0 == strcmp(op, "JB"))  { o->oper = "<";  o->sign = 0; return true; }
+  if (0 == strcmp(op, "JBE")) { o->oper = "<="; o->sign = 0; return true; }
+  if (0 == strcmp(op, "JA"))  { o->oper = ">";  o->sign = 0; return true; }
+  if (0 == strcmp(op, "JAE")) { o->oper = ">="; o->sign = 0; return true; }
+  if (0 == strcmp(op, "JE"))  { o->oper = "=="; o->sign = 0; return true; }
+  if (0 == strcmp(op, "JNE")) { o->oper = "!="; o->sign = 0; return true; }
+  if (0 == strcmp(op, "JL"))  { o->oper = "<";  o->sign = 1; return true; }
+  if (0 == strcmp(op, "JLE")) { o->oper = "<="; o->sign = 1; return true; }
+  if (0 == strcmp(op, "JG"))  { o->oper = ">";  o->sign = 1; return true; }
+  if (0 == strcmp(op, "JGE")) { o->oper = ">="; o->sign = 1; return true; }
+  return false;
+}
+
 static operator_t jump_operation(const char *op)
 {
-  operator_t o = {};
-  if (0 == strcmp(op, "JB"))  { o.oper = "<";  o.sign = 0; return o; }
-  if (0 == strcmp(op, "JBE")) { o.oper = "<="; o.sign = 0; return o; }
-  if (0 == strcmp(op, "JA"))  { o.oper = ">";  o.sign = 0; return o; }
-  if (0 == strcmp(op, "JAE")) { o.oper = ">="; o.sign = 0; return o; }
-  if (0 == strcmp(op, "JE"))  { o.oper = "=="; o.sign = 0; return o; }
-  if (0 == strcmp(op, "JNE")) { o.oper = "!="; o.sign = 0; return o; }
-  if (0 == strcmp(op, "JL"))  { o.oper = "<";  o.sign = 1; return o; }
-  if (0 == strcmp(op, "JLE")) { o.oper = "<="; o.sign = 1; return o; }
-  if (0 == strcmp(op, "JG"))  { o.oper = ">";  o.sign = 1; return o; }
-  if (0 == strcmp(op, "JGE")) { o.oper = ">="; o.sign = 1; return o; }
+  operator_t o;
+  if (try_jump_operation(op, &o)) return o;
 
   FAIL("Unexpected jump operation: '%s'", op);
 }
@@ -44,10 +52,10 @@ void transform_pass_cmp_jmp(meh_t *m)
     expr_branch_flags_t *k = expr->k.branch_flags;
     size_t prev_idx = i-1;
     expr_t *prev_expr = &m->expr_arr[i-1];
+    if (prev_expr->kind != EXPR_KIND_ABSTRACT) continue;
+
     value_t prev_dest = expr_destination(prev_expr);
     if (!value_matches(&k->flags, &prev_dest)) continue;
-
-    if (prev_expr->kind != EXPR_KIND_ABSTRACT) continue;
     expr_abstract_t *p = prev_expr->k.abstract;
     if (p->n_args != 2) continue;
 
@@ -68,6 +76,7 @@ void transform_pass_cmp_jmp(meh_t *m)
 
     // Ignore the extra instruction
     m->expr_arr[i] = EXPR_NONE;
+    STAT_INC(FUSED_CMP_JMP);
   }
 }
 
@@ -106,6 +115,7 @@ void transform_pass_or_jmp(meh_t *m)
 
     // Ignore the extra instruction
     m->expr_arr[i] = EXPR_NONE;
+    STAT_INC(FUSED_OR_JMP);
   }
 }
 
@@ -184,6 +194,7 @@ void _synthesize_calls_one(meh_t *m, size_t i)
   // Update the ins array tracking
   expr->ins = first_ins;
   expr->n_ins = ins_count;
+  STAT_INC(FUSED_CALLS);
 }
 
 void transform_pass_synthesize_calls(meh_t *m)
@@ -192,3 +203,354 @@ void transform_pass_synthesize_calls(meh_t *m)
     _synthesize_calls_one(m, i);
   }
 }
+
+// Registers an operand reads to be located: itself, or its address
+static uint32_t operand_regs(const operand_t *o)
+{
+  switch (o->type) {
+    case OPERAND_TYPE_REG: return reg_info[o->u.reg.id].alias;
+    case OPERAND_TYPE_MEM: return reg_info[o->u.mem.sreg].alias | reg_info[o->u.mem.reg1].alias |
+                                  reg_info[o->u.mem.reg2].alias;
+    default:               return 0;
+  }
+}
+
+static bool operand_is_word(const operand_t *o)
+{
+  switch (o->type) {
+    case OPERAND_TYPE_REG: return reg_info[o->u.reg.id].bits == 16;
+    case OPERAND_TYPE_MEM: return o->u.mem.sz == SIZE_16;
+    case OPERAND_TYPE_IMM: return true;
+    default:               return false;
+  }
+}
+
+// add lo,a; adc hi,b (or sub/sbb): the low half's write mustn't change
+// anything the high half reads, and a low half in memory needs its high
+// half in the word right after it so that nothing else can overlap
+static bool long_pair_ok(dis86_instr_t *lo, dis86_instr_t *hi)
+{
+  operand_t *lo_d = &lo->operand[0], *lo_s = &lo->operand[1];
+  operand_t *hi_d = &hi->operand[0], *hi_s = &hi->operand[1];
+  if (!operand_is_word(lo_d) || !operand_is_word(lo_s)) return false;
+  if (!operand_is_word(hi_d) || !operand_is_word(hi_s)) return false;
+  if (hi->rep != REP_NONE) return false;
+
+  if (lo_d->type == OPERAND_TYPE_REG) {
+    return !(reg_info[lo_d->u.reg.id].alias & (operand_regs(hi_d) | operand_regs(hi_s)));
+  }
+  if (lo_d->type == OPERAND_TYPE_MEM) {
+    if (hi_d->type != OPERAND_TYPE_MEM || hi_s->type == OPERAND_TYPE_MEM) return false;
+    const operand_mem_t *a = &lo_d->u.mem, *b = &hi_d->u.mem;
+    return a->sreg == b->sreg && a->reg1 == b->reg1 && a->reg2 == b->reg2 && (uint16_t)(a->off + 2) == b->off;
+  }
+  return false;
+}
+
+static void long_from_pair(expr_t *expr, symbols_t *symbols, const char *oper, dis86_instr_t *lo, dis86_instr_t *hi)
+{
+  value_t dest[2] = { value_from_operand(&lo->operand[0], symbols), value_from_operand(&hi->operand[0], symbols) };
+  value_t src[2]  = { value_from_operand(&lo->operand[1], symbols), value_from_operand(&hi->operand[1], symbols) };
+
+  expr->kind = EXPR_KIND_OPERATOR32;
+  expr_operator32_t *k = expr->k.operator32;
+  k->op.oper  = oper;
+  k->op.sign  = 0;
+  for (size_t i = 0; i < 2; i++) {
+    k->dest[i]  = dest[i];
+    k->left[i]  = dest[i];
+    k->right[i] = src[i];
+  }
+}
+
+void transform_pass_long_ops(meh_t *m, symbols_t *symbols, const cfg_t *cfg, dis86_instr_t *ins_base)
+{
+  for (size_t i = 0; i < m->expr_len; i++) {
+    expr_t *expr = &m->expr_arr[i];
+    if (expr->n_ins != 1) continue;
+    dis86_instr_t *ins = expr->ins;
+
+    switch (ins->opcode) {
+      case operation_e::ADD:
+      case operation_e::SUB: {
+        if (expr->kind != EXPR_KIND_OPERATOR2) continue;
+        if (i+1 >= m->expr_len) continue;
+        expr_t *next = &m->expr_arr[i+1];
+        if (next->kind != EXPR_KIND_UNKNOWN || next->n_ins != 1) continue;
+        operation_e carry_op = ins->opcode == operation_e::ADD ? operation_e::ADC : operation_e::SBB;
+        if (next->ins->opcode != carry_op) continue;
+        if (!cfg_same_block(cfg, ins - ins_base, next->ins - ins_base)) continue;
+        if (!long_pair_ok(ins, next->ins)) continue;
+
+        long_from_pair(expr, symbols, ins->opcode == operation_e::ADD ? "+" : "-", ins, next->ins);
+        expr->n_ins++;
+        m->expr_arr[i+1] = EXPR_NONE;
+      } break;
+
+      case operation_e::MUL:
+      case operation_e::IMUL: {
+        // Only the one operand word form: DX:AX = AX * r/m16. imul dx,ax,imm
+        // decodes alike but keeps just the low word in DX.
+        if (ins->operand[0].type != OPERAND_TYPE_REG || ins->operand[0].u.reg.id != REG_DX) continue;
+        if (ins->operand[1].type != OPERAND_TYPE_REG || ins->operand[1].u.reg.id != REG_AX) continue;
+        if (ins->operand[2].type == OPERAND_TYPE_IMM) continue;
+
+        expr->kind = EXPR_KIND_OPERATOR32;
+        expr_operator32_t *k = expr->k.operator32;
+        k->op.oper  = "*";
+        k->op.sign  = ins->opcode == operation_e::IMUL;
+        k->dest[0]  = value_from_symref(symbols_find_reg(symbols, REG_AX));
+        k->dest[1]  = value_from_symref(symbols_find_reg(symbols, REG_DX));
+        k->left[0]  = k->dest[0];
+        k->left[1]  = VALUE_NONE;
+        k->right[0] = value_from_operand(&ins->operand[2], symbols);
+        k->right[1] = VALUE_NONE;
+      } break;
+
+      case operation_e::LES:
+      case operation_e::LDS: {
+        // seg:reg = far pointer
+        if (expr->kind != EXPR_KIND_ABSTRACT) continue;
+
+        expr->kind = EXPR_KIND_OPERATOR32;
+        expr_operator32_t *k = expr->k.operator32;
+        k->op.oper  = "=";
+        k->op.sign  = 0;
+        k->dest[0]  = value_from_operand(&ins->operand[1], symbols);
+        k->dest[1]  = value_from_operand(&ins->operand[0], symbols);
+        k->left[0]  = value_from_operand(&ins->operand[2], symbols);
+        k->left[1]  = VALUE_NONE;
+        k->right[0] = VALUE_NONE;
+        k->right[1] = VALUE_NONE;
+      } break;
+
+      default:
+        continue;
+    }
+    STAT_INC(FUSED_LONG_OPS);
+  }
+}
+
+// 0 or 1 if a cld/std earlier in the instruction's block settles the
+// direction flag, -1 if nothing in the block does
+static int direction_flag(const cfg_t *cfg, dis86_instr_t *ins_base, dis86_instr_t *ins)
+{
+  size_t idx = ins - ins_base;
+  uint32_t start = cfg->blocks[cfg->block_of[idx]].start;
+  for (size_t j = idx; j-- > start; ) {
+    operation_e op = ins_base[j].opcode;
+    if (op == operation_e::CLD) return 0;
+    if (op == operation_e::STD) return 1;
+    if (instr_flags[size_t(op)].written & FLAG_DF) return -1;
+  }
+  return -1;
+}
+
+void transform_pass_rep_string(meh_t *m, symbols_t *symbols, const cfg_t *cfg, dis86_instr_t *ins_base)
+{
+  auto reg = [&](int id) { return value_from_symref(symbols_find_reg(symbols, id)); };
+
+  for (size_t i = 0; i < m->expr_len; i++) {
+    expr_t *expr = &m->expr_arr[i];
+    if (expr->kind != EXPR_KIND_UNKNOWN || expr->n_ins != 1) continue;
+    dis86_instr_t *ins = expr->ins;
+    if (ins->rep == REP_NONE) continue;
+
+    // The mem operands are ES:DI and (overridable) DS:SI
+    const operand_t *dst = nullptr, *src = nullptr;
+    for (size_t j = 0; j < ARRAY_SIZE(ins->operand); j++) {
+      const operand_t *o = &ins->operand[j];
+      if (o->type != OPERAND_TYPE_MEM) continue;
+      if (o->u.mem.reg1 == REG_DI) dst = o;
+      else                         src = o;
+    }
+    if (!dst) continue;
+    bool word = dst->u.mem.sz == SIZE_16;
+
+    int df = direction_flag(cfg, ins_base, ins);
+    if (df < 0) continue;
+
+    expr_abstract_t *k = expr->k.abstract;
+    k->ret = VALUE_NONE;
+    switch (ins->opcode) {
+      case operation_e::MOVS: {
+        // Either prefix repeats CX times
+        static const char *names[2][2] = {{"MEMCPY_8", "MEMCPY_16"}, {"MEMCPY_DOWN_8", "MEMCPY_DOWN_16"}};
+        k->func_name = names[df][word];
+        k->n_args    = 5;
+        k->args[0]   = reg(REG_ES);
+        k->args[1]   = reg(REG_DI);
+        k->args[2]   = reg(src->u.mem.sreg);
+        k->args[3]   = reg(REG_SI);
+        k->args[4]   = reg(REG_CX);
+      } break;
+
+      case operation_e::STOS: {
+        static const char *names[2][2] = {{"MEMSET_8", "MEMSET_16"}, {"MEMSET_DOWN_8", "MEMSET_DOWN_16"}};
+        k->func_name = names[df][word];
+        k->n_args    = 4;
+        k->args[0]   = reg(REG_ES);
+        k->args[1]   = reg(REG_DI);
+        k->args[2]   = reg(word ? REG_AX : REG_AL);
+        k->args[3]   = reg(REG_CX);
+      } break;
+
+      case operation_e::SCAS: {
+        // repne scasb: forward search for AL
+        if (df || word || ins->rep != REP_NE) continue;
+        k->func_name = "MEMCHR_8";
+        k->ret       = reg(REG_FLAGS);
+        k->n_args    = 4;
+        k->args[0]   = reg(REG_ES);
+        k->args[1]   = reg(REG_DI);
+        k->args[2]   = reg(REG_AL);
+        k->args[3]   = reg(REG_CX);
+      } break;
+
+      case operation_e::CMPS: {
+        // repe cmpsb: forward compare, flags from [SI] - [DI]
+        if (df || word || ins->rep != REP_E) continue;
+        k->func_name = "MEMCMP_8";
+        k->ret       = reg(REG_FLAGS);
+        k->n_args    = 5;
+        k->args[0]   = reg(src->u.mem.sreg);
+        k->args[1]   = reg(REG_SI);
+        k->args[2]   = reg(REG_ES);
+        k->args[3]   = reg(REG_DI);
+        k->args[4]   = reg(REG_CX);
+      } break;
+
+      default:
+        continue;
+    }
+    expr->kind = EXPR_KIND_ABSTRACT;
+    STAT_INC(FUSED_REP_STRING);
+  }
+}
+
+static bool value_is_memory(value_t *v)
+{
+  if (v->type == VALUE_TYPE_MEM) return true;
+  return v->type == VALUE_TYPE_SYM && SYM_ID_KIND(v->u.sym->ref.id) == SYM_KIND_GLOBAL;
+}
+
+static bool expr_may_store(expr_t *expr)
+{
+  switch (expr->kind) {
+    case EXPR_KIND_UNKNOWN:        return true;
+    case EXPR_KIND_CALL:           return true;
+    case EXPR_KIND_CALL_WITH_ARGS: return true;
+    case EXPR_KIND_OPERATOR1:      return value_is_memory(&expr->k.operator1->dest);
+    case EXPR_KIND_OPERATOR2:      return value_is_memory(&expr->k.operator2->dest);
+    case EXPR_KIND_OPERATOR3:      return value_is_memory(&expr->k.operator3->dest);
+    case EXPR_KIND_OPERATOR32:     return value_is_memory(&expr->k.operator32->dest[0]) ||
+                                          value_is_memory(&expr->k.operator32->dest[1]);
+    case EXPR_KIND_ABSTRACT: {
+      expr_abstract_t *k = expr->k.abstract;
+      if (0 == memcmp(k->func_name, "PUSH", 4)) return true;
+      if (0 == strncmp(k->func_name, "MEMCPY", 6) || 0 == strncmp(k->func_name, "MEMSET", 6)) return true;
+      return value_is_memory(&k->ret);
+    }
+    default: return false;
+  }
+}
+
+void transform_pass_fuse_flags(meh_t *m, const ssa_t *ssa)
+{
+  for (size_t i = 0; i < m->expr_len; i++) {
+    expr_t *expr = &m->expr_arr[i];
+    if (expr->kind != EXPR_KIND_BRANCH_FLAGS) continue;
+
+    expr_branch_flags_t *k = expr->k.branch_flags;
+    operator_t op;
+    if (!try_jump_operation(k->op, &op)) continue;
+    if (k->flags.type != VALUE_TYPE_SYM) continue;
+
+    // Find the producer through the flags def reaching the branch
+    uint32_t var = ssa_var_of(ssa, k->flags.u.sym->ref.id);
+    uint32_t def = ssa_reaching_def(ssa, i, var);
+    if (def == SSA_NONE || ssa->defs[def].kind != SSA_DEF_EXPR) continue;
+    size_t j = ssa->defs[def].site;
+    if (ssa->expr_block[j] != ssa->expr_block[i]) continue;
+
+    expr_t *prev_expr = &m->expr_arr[j];
+    if (prev_expr->kind != EXPR_KIND_ABSTRACT) continue;
+    expr_abstract_t *p = prev_expr->k.abstract;
+    if (0 != strcmp(p->func_name, "CMP") || p->n_args != 2) continue;
+
+    // The compared values must still be the same at the branch
+    bool reads_memory = value_is_memory(&p->args[0]) || value_is_memory(&p->args[1]);
+    bool unchanged = true;
+    for (size_t x = j+1; unchanged && x < i; x++) {
+      for (uint32_t u = ssa->use_off[j]; unchanged && u < ssa->use_off[j+1]; u++) {
+        if (ssa_expr_def(ssa, x, ssa->uses[u].var) != SSA_NONE) unchanged = false;
+      }
+      if (reads_memory && expr_may_store(&m->expr_arr[x])) unchanged = false;
+    }
+    if (!unchanged) continue;
+
+    // Save
+    value_t  left   = p->args[0];
+    value_t  right  = p->args[1];
+    uint32_t target = k->target;
+
+    // Rewrite: the producer stays put and is left to the lazy flags pass
+    expr->kind = EXPR_KIND_BRANCH_COND;
+    expr_branch_cond_t *b = expr->k.branch_cond;
+    b->op     = op;
+    b->left   = left;
+    b->right  = right;
+    b->target = target;
+    STAT_INC(FUSED_FLAGS);
+  }
+}
+
+void transform_pass_lazy_flags(meh_t *m, const flags_t *f)
+{
+  for (size_t i = 0; i < m->expr_len; i++) {
+    expr_t *expr = &m->expr_arr[i];
+    if (expr->kind != EXPR_KIND_ABSTRACT) continue;
+
+    expr_abstract_t *k = expr->k.abstract;
+    if (0 != strcmp(k->func_name, "CMP") && 0 != strcmp(k->func_name, "TEST")) continue;
+    if (flags_observed(f, i)) continue;
+
+    // Nothing reads the result: keep the instructions for the listing only
+    expr->kind = EXPR_KIND_NONE;
+    STAT_INC(DROPPED_FLAGS);
+  }
+}
+
+// Only writes to registers (and the flags along with them) can go: anything
+// storing to memory or the stack, calling out or branching stays
+static bool expr_writes_registers_only(expr_t *expr)
+{
+  switch (expr->kind) {
+    case EXPR_KIND_OPERATOR1:
+    case EXPR_KIND_OPERATOR2:
+    case EXPR_KIND_OPERATOR3:
+    case EXPR_KIND_ABSTRACT:
+      break;
+    default:
+      return false;
+  }
+
+  value_t dest = expr_destination(expr);
+  return dest.type == VALUE_TYPE_SYM && SYM_ID_KIND(dest.u.sym->ref.id) == SYM_KIND_REGISTER;
+}
+
+bool transform_pass_dead_stores(meh_t *m, const liveness_t *l, const flags_t *f)
+{
+  bool changed = false;
+  for (size_t i = 0; i < m->expr_len; i++) {
+    expr_t *expr = &m->expr_arr[i];
+    if (!expr_writes_registers_only(expr)) continue;
+    if (liveness_observed(l, i) || flags_observed(f, i)) continue;
+
+    // Keep the instructions for the listing only
+    expr->kind = EXPR_KIND_NONE;
+    STAT_INC(DROPPED_STORES);
+    changed = true;
+  }
+  return changed;
+}
@@ -11,3 +11,23 @@ void transform_pass_or_jmp(meh_t *m);
 
 // synthesize normal calls where possible
 void transform_pass_synthesize_calls(meh_t *m);
+
+// add/adc and sub/sbb pairs, mul/imul into DX:AX and les/lds => 32-bit operations
+void transform_pass_long_ops(meh_t *m, symbols_t *symbols, const cfg_t *cfg, dis86_instr_t *ins_base);
+
+// rep movs/stos, repne scasb and repe cmpsb after a cld/std in the same block
+// => MEMCPY/MEMSET/MEMCHR/MEMCMP runtime calls. These carry the exact string
+// instruction semantics: copies run element by element (an overlapping
+// forward copy replicates), SI/DI/CX are left where the loop leaves them and
+// MEMCHR/MEMCMP set the flags of the last compare.
+void transform_pass_rep_string(meh_t *m, symbols_t *symbols, const cfg_t *cfg, dis86_instr_t *ins_base);
+
+// cmp a,b; ...; j{pred} target => {c-style code} when a and b are unchanged in between
+void transform_pass_fuse_flags(meh_t *m, const ssa_t *ssa);
+
+// drop flag producers (cmp, test) whose result is never observed
+void transform_pass_lazy_flags(meh_t *m, const flags_t *f);
+
+// drop register and flag writes nothing reads, returning true if any went
+// (leaving the analyses it was given stale)
+bool transform_pass_dead_stores(meh_t *m, const liveness_t *l, const flags_t *f);
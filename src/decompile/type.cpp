@@ -24,10 +24,10 @@ static bool basetype_parse(const char *s, size_t len, int *out)
 {
   int t = -1;
   if (len == 2) {
-    if (0 == memcmp(s, "uint8_t", 2)) t = BASETYPE_U8;
+    if (0 == memcmp(s, "u8", 2)) t = BASETYPE_U8;
   } else if (len == 3) {
-    if (0 == memcmp(s, "uint16_t", 3)) t = BASETYPE_U16;
-    if (0 == memcmp(s, "uint32_t", 3)) t = BASETYPE_U32;
+    if (0 == memcmp(s, "u16", 3)) t = BASETYPE_U16;
+    if (0 == memcmp(s, "u32", 3)) t = BASETYPE_U32;
   }
 
   if (t == -1) return false;
@@ -6,31 +6,28 @@ value_t value_from_operand(operand_t *o, symbols_t *symbols)
 
   switch (o->type) {
     case OPERAND_TYPE_REG: {
-      sym_t deduced_sym[1];
-      sym_deduce_reg(deduced_sym, o->u.reg.id);
-
       val->type = VALUE_TYPE_SYM;
-      val->u.sym->ref = symbols_find_ref(symbols, deduced_sym);
-      assert(val->u.sym->ref.symbol);
+      val->u.sym->ref = symbols_find_reg(symbols, o->u.reg.id);
+      assert(val->u.sym->ref.id);
     } break;
     case OPERAND_TYPE_MEM: {
       operand_mem_t *m = &o->u.mem;
       symref_t ref = symbols_find_mem(symbols, m);
-      if (ref.symbol) {
+      if (ref.id) {
         val->type = VALUE_TYPE_SYM;
         val->u.sym->ref = ref;
       } else {
         val->type = VALUE_TYPE_MEM;
-        val->u.mem->sz   = m->sz;
-        val->u.mem->sreg = symbols_find_reg(symbols, m->sreg);
-        val->u.mem->reg1 = symbols_find_reg(symbols, m->reg1);
-        val->u.mem->reg2 = symbols_find_reg(symbols, m->reg2);
+        val->u.mem->sz   = (uint8_t)m->sz;
+        val->u.mem->sreg = (uint8_t)m->sreg;
+        val->u.mem->reg1 = (uint8_t)m->reg1;
+        val->u.mem->reg2 = (uint8_t)m->reg2;
         val->u.mem->off  = m->off;
       }
     } break;
     case OPERAND_TYPE_IMM: {
       val->type         = VALUE_TYPE_IMM;
-      val->u.imm->sz    = o->u.imm.sz;
+      val->u.imm->sz    = (uint8_t)o->u.imm.sz;
       val->u.imm->value = o->u.imm.val;
     } break;
     case OPERAND_TYPE_REL: {
@@ -47,9 +44,9 @@ value_t value_from_operand(operand_t *o, symbols_t *symbols)
 
 value_t value_from_symref(symref_t ref)
 {
-  assert(ref.symbol);
+  assert(ref.id);
 
-  value_t val[1];
+  value_t val[1] = {{}};
   val->type = VALUE_TYPE_SYM;
   val->u.sym->ref = ref;
   return *val;
@@ -57,7 +54,7 @@ value_t value_from_symref(symref_t ref)
 
 value_t value_from_imm(uint16_t imm)
 {
-  value_t val[1];
+  value_t val[1] = {{}};
   val->type = VALUE_TYPE_IMM;
   val->u.imm->sz = SIZE_16;
   val->u.imm->value = imm;
@@ -78,9 +75,9 @@ bool value_matches(value_t *a, value_t *b)
       value_mem_t *bk = b->u.mem;
       return
         ak->sz == bk->sz &&
-        symref_matches(&ak->sreg, &bk->sreg) &&
-        symref_matches(&ak->reg1, &bk->reg1) &&
-        symref_matches(&ak->reg2, &bk->reg2) &&
+        ak->sreg == bk->sreg &&
+        ak->reg1 == bk->reg1 &&
+        ak->reg2 == bk->reg2 &&
         ak->off == bk->off;
     } break;
     case VALUE_TYPE_IMM: {
@@ -19,29 +19,32 @@ struct value_sym_t
 struct value_mem_t
 {
   // TODO: Remove 8086-isms and dis86-isms
-  int        sz; // SIZE_*
-  symref_t   sreg;
-  symref_t   reg1;
-  symref_t   reg2;
-  uint16_t        off;
+  uint8_t  sz;    // SIZE_*
+  uint8_t  sreg;  // REG_*: always whole registers, REG_INVAL if unused
+  uint8_t  reg1;
+  uint8_t  reg2;
+  uint16_t off;
 };
 
 struct value_imm_t
 {
   // TODO: Remove 8086-isms and dis86-isms
-  int sz; // SIZE_*
+  uint8_t  sz; // SIZE_*
   uint16_t value;
 };
 
+// Values are embedded by the dozen in every expression, so they are kept
+// to a handful of integers: symbols by id, memory operands by register id
 struct value_t
 {
-  int type;
+  uint8_t type;
   union {
     value_sym_t sym[1];
     value_mem_t mem[1];
     value_imm_t imm[1];
   } u;
 };
+static_assert(sizeof(value_t) <= 12, "");
 
 value_t value_from_operand(operand_t *o, symbols_t *symbols);
 value_t value_from_symref(symref_t ref);
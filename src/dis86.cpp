@@ -7,11 +7,20 @@ dis86_t *dis86_new(size_t base_addr, segment<uint8_t> mem)
   return d;
 }
 
+dis86_t *dis86_new_view(size_t base_addr, segment<uint8_t> mem, const dos::relocation_index_t *relocs)
+{
+  dis86_t *d = (dis86_t*)calloc(1, sizeof(dis86_t));
+  binary_init_view(d->b, base_addr, mem, relocs);
+  return d;
+}
+
 void dis86_delete(dis86_t *d)
 {
+  binary_fini(d->b);
   free(d);
 }
 
 size_t dis86_position(dis86_t *d) { return binary_location(d->b); }
 size_t dis86_baseaddr(dis86_t *d) { return binary_baseaddr(d->b); }
 size_t dis86_length(dis86_t *d)   { return binary_length(d->b);   }
+bool   dis86_is_relocation(dis86_t *d, size_t addr) { return binary_is_reloc(d->b, addr); }
@@ -37,6 +37,10 @@ enum {
 /* Create new instance: deep copies the memory */
 dis86_t *dis86_new(size_t base_addr, segment<uint8_t> mem);
 
+/* Create new instance over memory owned by the caller (e.g. a mapped executable).
+   No copy is made: 'mem' and 'relocs' (optional) must outlive the instance */
+dis86_t *dis86_new_view(size_t base_addr, segment<uint8_t> mem, const dos::relocation_index_t *relocs);
+
 /* Destroys an instance */
 void dis86_delete(dis86_t *d);
 
@@ -52,6 +56,36 @@ size_t dis86_baseaddr(dis86_t *d);
 /* Get Length */
 size_t dis86_length(dis86_t *d);
 
+/* Is the 16-bit word at 'addr' patched by the loader (i.e. a segment constant)? */
+bool dis86_is_relocation(dis86_t *d, size_t addr);
+
+/*****************************************************************/
+/* ERROR-RETURNING ROUTINES */
+/*****************************************************************/
+
+/* The routines in this header report bad input (undecodable bytes, a
+   malformed config, a function the decompiler can't handle) by printing and
+   exiting. The _checked variants return it instead, leaving the instance,
+   config and its caches usable, so a batch or long-lived process can skip
+   the offending function and carry on. */
+
+typedef enum dis86_status {
+  DIS86_OK = 0,
+  DIS86_END,    /* no more instructions */
+  DIS86_ERROR,  /* see the dis86_error_t */
+} dis86_status_t;
+
+typedef struct dis86_error dis86_error_t;
+struct dis86_error
+{
+  size_t addr;      /* decode: start of the bad instruction; decompile: start of the function */
+  char   msg[256];
+};
+
+/* Like dis86_next. On DIS86_ERROR the decoder has moved one byte past the
+   start of the bad instruction, so calling again resynchronises */
+dis86_status_t dis86_next_checked(dis86_t *d, dis86_instr_t **_ins, dis86_error_t *err);
+
 /*****************************************************************/
 /* INSTR ROUTINES */
 /*****************************************************************/
@@ -79,8 +113,50 @@ std::string dis86_print_intel_syntax(dis86_t *d, dis86_instr_t *ins, bool with_d
 
 /* Construct a config from file */
 dis86_decompile_config_t * dis86_decompile_config_read_new(const char *path);
+/* Like dis86_decompile_config_read_new, but returns nullptr and fills 'err' on failure */
+dis86_decompile_config_t * dis86_decompile_config_read_checked(const char *path, dis86_error_t *err);
+/* Construct an empty config */
+dis86_decompile_config_t * dis86_decompile_config_default_new(void);
 void                       dis86_decompile_config_delete(dis86_decompile_config_t *cfg);
 
+/* What changed between two configs, and what that did to the cached decompilations */
+typedef struct dis86_decompile_config_diff dis86_decompile_config_diff_t;
+struct dis86_decompile_config_diff
+{
+  size_t funcs;        /* functions added, removed or edited */
+  size_t globals;      /* globals added, removed or edited */
+  size_t segmaps;      /* segmaps added, removed or edited */
+  size_t kept;         /* cached decompilations carried over */
+  size_t invalidated;  /* cached decompilations dropped */
+};
+
+/* Moves the cached decompilations of 'old_cfg' (typically the previous read
+   of the same file) over to 'cfg', dropping only those that consult a
+   function, global or segmap that differs between the two. 'old_cfg' is
+   left without a cache and may then be deleted. */
+void                       dis86_decompile_config_take_cache(dis86_decompile_config_t *      cfg,
+                                                             dis86_decompile_config_t *      old_cfg,
+                                                             dis86_decompile_config_diff_t * opt_diff);
+
+/* Hash of just the config entries a decompile of 'ins' would consult (optional cfg) */
+uint64_t                   dis86_decompile_config_deps_hash(dis86_decompile_config_t * opt_cfg,
+                                                            uint16_t                   seg,
+                                                            dis86_instr_t *            ins,
+                                                            size_t                     n_ins);
+
+/* Add config functions for library routines recognised by a signature file
+   in the part of 'mem' (at linear 'base_addr') visible from 'seg'. Returns the number added. */
+size_t                     dis86_decompile_config_apply_signatures(dis86_decompile_config_t * cfg,
+                                                                   const char *               sig_path,
+                                                                   segment<uint8_t>           mem,
+                                                                   size_t                     base_addr,
+                                                                   uint16_t                   seg);
+
+/* Optional observer told when each phase of dis86_decompile begins and ends
+   (for profiling). Pass nullptr to remove it. */
+typedef void (*dis86_decompile_phase_fn_t)(void *user, const char *phase, bool end);
+void                       dis86_decompile_set_phase_observer(dis86_decompile_phase_fn_t fn, void *user);
+
 /* Decompile to C code */
 std::string dis86_decompile(dis86_t *                  dis,
                             dis86_decompile_config_t * opt_cfg, /* optional */
@@ -89,5 +165,16 @@ std::string dis86_decompile(dis86_t *                  dis,
                             dis86_instr_t *            ins,
                             size_t                     n_ins );
 
+/* Like dis86_decompile, but a function that can't be decompiled yields
+   DIS86_ERROR and 'err' instead of exiting. Nothing is memoised for it */
+dis86_status_t dis86_decompile_checked(dis86_t *                  dis,
+                                       dis86_decompile_config_t * opt_cfg, /* optional */
+                                       const char *               func_name,
+                                       uint16_t                   seg,
+                                       dis86_instr_t *            ins,
+                                       size_t                     n_ins,
+                                       std::string *              out,
+                                       dis86_error_t *            err);
+
 
 #endif
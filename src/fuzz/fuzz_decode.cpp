@@ -0,0 +1,300 @@
+#include "dis86.h"
+#include "instr.h"
+#include "bench/encode.h"
+#include "cmdarg/cmdarg.h"
+#include "common/common.h"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+// Decode fuzzer
+//
+// Each input is read as a sequence of choices that build a stream of valid
+// encodings from the instruction table (the same way the benchmark streams
+// are built), so every input exercises the decoder instead of tripping over
+// the first invalid opcode. The stream is then decoded and printed, checking:
+//
+//   - instructions tile the stream: each starts where the previous ended and
+//     none extends past the end of the region
+//   - an instruction's n_bytes equals what the decoder consumed, and matches
+//     the boundary the stream was built with
+//   - decoding an instruction on its own, in a region cut to exactly its
+//     n_bytes, gives the same instruction and the same text (so the decoder
+//     never looks past the bytes it claims)
+//   - a copying instance decodes and prints identically to a view
+//
+// The raw input is also decoded as-is through dis86_next_checked, which must
+// never exit: each step either yields an instruction that fits the region
+// or reports an error at the current position and skips exactly one byte.
+//
+// Violations abort(), which libFuzzer reports with the input. Built without
+// libFuzzer (the default) the same target runs random inputs or replays
+// files, writes a failing input to crash-decode.bin, and reports the decode
+// throughput over everything it ran so speed work can be checked against the
+// same streams.
+
+#define MAX_STREAM 4096
+
+typedef struct reader reader_t;
+struct reader
+{
+  const uint8_t * p;
+  size_t          n;
+  size_t          i;
+};
+
+static uint8_t reader_next(reader_t *r)
+{
+  return r->i < r->n ? r->p[r->i++] : 0;
+}
+
+typedef struct stream stream_t;
+struct stream
+{
+  std::vector<uint8_t> bytes;
+  std::vector<size_t>  ends;  /* instruction boundaries, as built */
+};
+
+static stream_t build_stream(const uint8_t *data, size_t size)
+{
+  static std::vector<const instr_fmt_t*> fmts = valid_fmts(false);
+
+  reader_t r[1] = {{data, size, 0}};
+  stream_t s;
+  while (r->i < r->n && s.bytes.size() + ENCODE_MAX <= MAX_STREAM) {
+    uint16_t pick = (uint16_t)(reader_next(r) << 8 | reader_next(r));
+    uint8_t ctl = reader_next(r);
+    const instr_fmt_t *fmt = fmts[pick % fmts.size()];
+
+    // Filler is peeked, then only what the decoder used is consumed
+    size_t n_fill = 0;
+    auto next = [&]() { return reader_next(r); };
+    auto fill = [&]() { size_t j = r->i + n_fill++; return j < r->n ? r->p[j] : (uint8_t)0; };
+
+    uint8_t buf[ENCODE_MAX];
+    size_t len = encode_instr(buf, fmt, ctl & 3, (ctl >> 2) & 1, next, fill);
+    r->i += len - (ENCODE_MAX - n_fill);
+
+    s.bytes.insert(s.bytes.end(), buf, buf + len);
+    s.ends.push_back(s.bytes.size());
+  }
+  return s;
+}
+
+/*****************************************************************/
+/* CHECKS */
+/*****************************************************************/
+
+static const uint8_t * cur_data;
+static size_t          cur_size;
+
+static void write_crash(void)
+{
+#ifndef DIS86_LIBFUZZER
+  FILE *f = fopen("crash-decode.bin", "wb");
+  if (!f) return;
+  fwrite(cur_data, 1, cur_size, f);
+  fclose(f);
+  fprintf(stderr, "input written to crash-decode.bin\n");
+#endif
+}
+
+#define CHECK(cond, ...) do { if (!(cond)) {                             \
+      fprintf(stderr, "CHECK FAILED: %s: ", #cond);                      \
+      fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n");               \
+      write_crash(); abort(); } } while (0)
+
+typedef struct totals totals_t;
+struct totals
+{
+  uint64_t runs;
+  uint64_t instrs;
+  uint64_t bytes;
+  double   decode_secs;
+};
+
+static totals_t totals;
+
+static void check_stream(const stream_t *s)
+{
+  uint8_t *mem = (uint8_t*)s->bytes.data();
+  size_t   len = s->bytes.size();
+
+  // Timed pass: plain decode over a view, as the front-ends do
+  std::vector<dis86_instr_t> ins;
+  ins.reserve(s->ends.size());
+  auto t0 = std::chrono::steady_clock::now();
+  dis86_t *d = dis86_new_view(0, segment<uint8_t>(mem, len), nullptr);
+  while (dis86_instr_t *i = dis86_next(d)) ins.push_back(*i);
+  totals.decode_secs += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  totals.instrs += ins.size();
+  totals.bytes  += len;
+
+  CHECK(ins.size() == s->ends.size(), "decoded %zu instructions, built %zu", ins.size(), s->ends.size());
+
+  dis86_t *copy = dis86_new(0, segment<uint8_t>(mem, len));
+  size_t pos = 0;
+  for (size_t k = 0; k < ins.size(); k++) {
+    dis86_instr_t *i = &ins[k];
+    CHECK(i->addr == pos, "instruction %zu at %zx, expected %zx", k, i->addr, pos);
+    CHECK(i->n_bytes > 0, "instruction %zu at %zx is empty", k, i->addr);
+    CHECK(i->addr + i->n_bytes <= len, "instruction %zu at %zx overruns the region", k, i->addr);
+    CHECK(i->addr + i->n_bytes == s->ends[k], "instruction %zu at %zx is %zu bytes, built %zu",
+          k, i->addr, i->n_bytes, s->ends[k] - i->addr);
+
+    // Same decode from a copying instance, position tracks n_bytes
+    dis86_instr_t *c = dis86_next(copy);
+    CHECK(c && c->n_bytes == i->n_bytes, "copy disagrees at %zx", i->addr);
+    CHECK(dis86_position(copy) == i->addr + i->n_bytes, "consumed %zu bytes at %zx, n_bytes %zu",
+          dis86_position(copy) - i->addr, i->addr, i->n_bytes);
+
+    std::string text   = dis86_print_intel_syntax(d, i, true);
+    std::string brief  = dis86_print_intel_syntax(d, i, false);
+    CHECK(!text.empty() && !brief.empty(), "empty text at %zx", i->addr);
+    CHECK(text == dis86_print_intel_syntax(copy, c, true), "copy prints differently at %zx", i->addr);
+
+    // On its own, in exactly n_bytes: any read beyond them fails the bounds check
+    dis86_t *alone = dis86_new_view(i->addr, segment<uint8_t>(mem + i->addr, i->n_bytes), nullptr);
+    dis86_instr_t *a = dis86_next(alone);
+    CHECK(a && a->n_bytes == i->n_bytes, "alone decodes to %zu bytes at %zx, in stream %zu",
+          a ? a->n_bytes : 0, i->addr, i->n_bytes);
+    CHECK(text == dis86_print_intel_syntax(alone, a, true), "alone prints differently at %zx", i->addr);
+    CHECK(!dis86_next(alone), "alone decodes a second instruction at %zx", i->addr);
+    dis86_delete(alone);
+
+    pos += i->n_bytes;
+  }
+  CHECK(!dis86_next(copy), "copy decodes past the end");
+  CHECK(pos == len, "instructions cover %zu of %zu bytes", pos, len);
+
+  dis86_delete(copy);
+  dis86_delete(d);
+}
+
+static void check_raw(const uint8_t *data, size_t size)
+{
+  dis86_t *d = dis86_new(0, segment<uint8_t>((uint8_t*)data, size));
+  size_t pos = 0;
+  while (1) {
+    dis86_instr_t *ins = nullptr;
+    dis86_error_t err[1] = {};
+    dis86_status_t st = dis86_next_checked(d, &ins, err);
+    if (st == DIS86_END) break;
+
+    if (st == DIS86_ERROR) {
+      CHECK(err->addr == pos, "error reported at %zx, decoding at %zx", err->addr, pos);
+      CHECK(err->msg[0], "error without a message at %zx", pos);
+      CHECK(dis86_position(d) == pos + 1, "error at %zx resumes at %zx", pos, dis86_position(d));
+      pos++;
+      continue;
+    }
+
+    CHECK(ins->addr == pos, "instruction at %zx, expected %zx", ins->addr, pos);
+    CHECK(ins->n_bytes > 0 && ins->addr + ins->n_bytes <= size, "instruction at %zx overruns the region", pos);
+    CHECK(dis86_position(d) == ins->addr + ins->n_bytes, "consumed %zu bytes at %zx, n_bytes %zu",
+          dis86_position(d) - ins->addr, pos, ins->n_bytes);
+    CHECK(!dis86_print_intel_syntax(d, ins, true).empty(), "empty text at %zx", pos);
+    pos += ins->n_bytes;
+  }
+  CHECK(pos == size, "stopped at %zx of %zx", pos, size);
+  dis86_delete(d);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  cur_data = data;
+  cur_size = size;
+
+  stream_t s = build_stream(data, size);
+  check_stream(&s);
+  check_raw(data, size);
+  totals.runs++;
+  return 0;
+}
+
+/*****************************************************************/
+/* STANDALONE DRIVER */
+/*****************************************************************/
+
+#ifndef DIS86_LIBFUZZER
+
+static void print_help(FILE *f, const char *appname)
+{
+  fprintf(f, "usage: %s [OPTIONS] [FILE...]\n", appname);
+  fprintf(f, "\n");
+  fprintf(f, "Replays each FILE as an input, or runs random inputs when none are given.\n");
+  fprintf(f, "\n");
+  fprintf(f, "OPTIONS:\n");
+  fprintf(f, "  --runs         number of random inputs (default 10000)\n");
+  fprintf(f, "  --seed         seed for the random inputs (default 1)\n");
+  fprintf(f, "  --max-len      maximum random input length in bytes (default 4096)\n");
+  fprintf(f, "  --json         report the run and decode throughput as JSON on stdout\n");
+}
+
+static void print_totals(bool json, uint64_t seed)
+{
+  double bps = totals.decode_secs > 0 ? totals.bytes  / totals.decode_secs : 0;
+  double ips = totals.decode_secs > 0 ? totals.instrs / totals.decode_secs : 0;
+  if (json) {
+    printf("{\n");
+    printf("  \"seed\": %llu,\n", (unsigned long long)seed);
+    printf("  \"runs\": %llu,\n", (unsigned long long)totals.runs);
+    printf("  \"instructions\": %llu,\n", (unsigned long long)totals.instrs);
+    printf("  \"bytes\": %llu,\n", (unsigned long long)totals.bytes);
+    printf("  \"decode_seconds\": %.6f,\n", totals.decode_secs);
+    printf("  \"decode_bytes_per_second\": %.1f,\n", bps);
+    printf("  \"decode_instructions_per_second\": %.1f\n", ips);
+    printf("}\n");
+    return;
+  }
+  printf("runs:    %llu ok\n", (unsigned long long)totals.runs);
+  printf("decoded: %llu instructions, %llu bytes in %.3f s\n",
+         (unsigned long long)totals.instrs, (unsigned long long)totals.bytes, totals.decode_secs);
+  printf("decode:  %.1f MB/s, %.0f instructions/s\n", bps / 1e6, ips);
+}
+
+int main(int argc, char *argv[])
+{
+  bool help = false;
+  cmdarg_option(&argc, &argv, "--help", &help);
+  if (help) { print_help(stdout, argv[0]); return 0; }
+
+  uint64_t runs = 10000;
+  cmdarg_uint64_t(&argc, &argv, "--runs", &runs);
+
+  uint64_t seed = 1;
+  cmdarg_uint64_t(&argc, &argv, "--seed", &seed);
+
+  uint64_t max_len = MAX_STREAM;
+  cmdarg_uint64_t(&argc, &argv, "--max-len", &max_len);
+  if (max_len == 0) { print_help(stderr, argv[0]); return 3; }
+
+  bool json = false;
+  cmdarg_option(&argc, &argv, "--json", &json);
+
+  for (int i = 1; i < argc; i++) {
+    if (argv[i][0] == '-') { print_help(stderr, argv[0]); return 3; }
+  }
+
+  if (argc > 1) {
+    for (int i = 1; i < argc; i++) {
+      dynarray mem = read_file(argv[i]);
+      LLVMFuzzerTestOneInput(mem.data(), mem.size());
+    }
+  } else {
+    std::mt19937 rng((uint32_t)seed);
+    std::vector<uint8_t> input;
+    for (uint64_t run = 0; run < runs; run++) {
+      input.resize(1 + rng() % max_len);
+      for (uint8_t& b : input) b = (uint8_t)rng();
+      LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+  }
+
+  print_totals(json, seed);
+  return 0;
+}
+
+#endif
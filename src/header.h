@@ -12,7 +12,10 @@
 #define MIN(a, b) (((a)<(b))?(a):(b))
 #define MAX(a, b) (((a)>(b))?(a):(b))
 #define ARRAY_SIZE(arr) (sizeof(arr)/sizeof((arr)[0]))
-#define FAIL(...) do { fprintf(stderr, "FAIL: "); fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n"); exit(42); } while(0)
+
+/* Reports and exits with status 42, or throws inside a fail_recover scope (common/fail.h) */
+[[noreturn]] void fail(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+#define FAIL(...) fail(__VA_ARGS__)
 #define UNIMPL() FAIL("UNIMPLEMENTED: %s:%d", __FILE__, __LINE__)
 
 
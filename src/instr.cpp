@@ -429,6 +429,220 @@ const std::array<const char* const, 93> instr_op_mneumonic =
     "xor",
 };
 
+const std::array<instr_flags_t, 93> instr_flags =
+{{
+    /* AAA    */ { FLAG_AF,                                 FLAG_STATUS                      },
+    /* AAS    */ { FLAG_AF,                                 FLAG_STATUS                      },
+    /* ADC    */ { FLAG_CF,                                 FLAG_STATUS                      },
+    /* ADD    */ { 0,                                       FLAG_STATUS                      },
+    /* AND    */ { 0,                                       FLAG_STATUS                      },
+    /* CALL   */ { 0,                                       0                                },
+    /* CALLF  */ { 0,                                       0                                },
+    /* CBW    */ { 0,                                       0                                },
+    /* CLC    */ { 0,                                       FLAG_CF                          },
+    /* CLD    */ { 0,                                       FLAG_DF                          },
+    /* CLI    */ { 0,                                       FLAG_IF                          },
+    /* CMC    */ { FLAG_CF,                                 FLAG_CF                          },
+    /* CMP    */ { 0,                                       FLAG_STATUS                      },
+    /* CMPS   */ { FLAG_DF,                                 FLAG_STATUS                      },
+    /* CWD    */ { 0,                                       0                                },
+    /* DAA    */ { FLAG_AF | FLAG_CF,                       FLAG_STATUS                      },
+    /* DAS    */ { FLAG_AF | FLAG_CF,                       FLAG_STATUS                      },
+    /* DEC    */ { 0,                                       FLAG_STATUS & ~FLAG_CF           },
+    /* DIV    */ { 0,                                       FLAG_STATUS                      },
+    /* ENTER  */ { 0,                                       0                                },
+    /* HLT    */ { 0,                                       0                                },
+    /* IMUL   */ { 0,                                       FLAG_STATUS                      },
+    /* IN     */ { 0,                                       0                                },
+    /* INC    */ { 0,                                       FLAG_STATUS & ~FLAG_CF           },
+    /* INS    */ { FLAG_DF,                                 0                                },
+    /* INT    */ { FLAG_ALL,                                FLAG_TF | FLAG_IF                },
+    /* INTO   */ { FLAG_ALL,                                FLAG_TF | FLAG_IF                },
+    /* INVAL  */ { FLAG_ALL,                                FLAG_ALL                         },
+    /* IRET   */ { 0,                                       FLAG_ALL                         },
+    /* JA     */ { FLAG_CF | FLAG_ZF,                       0                                },
+    /* JAE    */ { FLAG_CF,                                 0                                },
+    /* JB     */ { FLAG_CF,                                 0                                },
+    /* JBE    */ { FLAG_CF | FLAG_ZF,                       0                                },
+    /* JCXZ   */ { 0,                                       0                                },
+    /* JE     */ { FLAG_ZF,                                 0                                },
+    /* JG     */ { FLAG_ZF | FLAG_SF | FLAG_OF,             0                                },
+    /* JGE    */ { FLAG_SF | FLAG_OF,                       0                                },
+    /* JL     */ { FLAG_SF | FLAG_OF,                       0                                },
+    /* JLE    */ { FLAG_ZF | FLAG_SF | FLAG_OF,             0                                },
+    /* JMP    */ { 0,                                       0                                },
+    /* JMPF   */ { 0,                                       0                                },
+    /* JNE    */ { FLAG_ZF,                                 0                                },
+    /* JNO    */ { FLAG_OF,                                 0                                },
+    /* JNP    */ { FLAG_PF,                                 0                                },
+    /* JNS    */ { FLAG_SF,                                 0                                },
+    /* JO     */ { FLAG_OF,                                 0                                },
+    /* JP     */ { FLAG_PF,                                 0                                },
+    /* JS     */ { FLAG_SF,                                 0                                },
+    /* LAHF   */ { FLAG_SF | FLAG_ZF | FLAG_AF | FLAG_PF | FLAG_CF, 0                                },
+    /* LDS    */ { 0,                                       0                                },
+    /* LEA    */ { 0,                                       0                                },
+    /* LEAVE  */ { 0,                                       0                                },
+    /* LES    */ { 0,                                       0                                },
+    /* LODS   */ { FLAG_DF,                                 0                                },
+    /* LOOP   */ { 0,                                       0                                },
+    /* LOOPE  */ { FLAG_ZF,                                 0                                },
+    /* LOOPNE */ { FLAG_ZF,                                 0                                },
+    /* MOV    */ { 0,                                       0                                },
+    /* MOVS   */ { FLAG_DF,                                 0                                },
+    /* MUL    */ { 0,                                       FLAG_STATUS                      },
+    /* NEG    */ { 0,                                       FLAG_STATUS                      },
+    /* NOP    */ { 0,                                       0                                },
+    /* NOT    */ { 0,                                       0                                },
+    /* OR     */ { 0,                                       FLAG_STATUS                      },
+    /* OUT    */ { 0,                                       0                                },
+    /* OUTS   */ { FLAG_DF,                                 0                                },
+    /* POP    */ { 0,                                       0                                },
+    /* POPA   */ { 0,                                       0                                },
+    /* POPF   */ { 0,                                       FLAG_ALL                         },
+    /* PUSH   */ { 0,                                       0                                },
+    /* PUSHA  */ { 0,                                       0                                },
+    /* PUSHF  */ { FLAG_ALL,                                0                                },
+    /* RCL    */ { FLAG_CF,                                 FLAG_CF | FLAG_OF                },
+    /* RCR    */ { FLAG_CF,                                 FLAG_CF | FLAG_OF                },
+    /* RET    */ { 0,                                       0                                },
+    /* RETF   */ { 0,                                       0                                },
+    /* ROL    */ { 0,                                       FLAG_CF | FLAG_OF                },
+    /* ROR    */ { 0,                                       FLAG_CF | FLAG_OF                },
+    /* SAHF   */ { 0,                                       FLAG_SF | FLAG_ZF | FLAG_AF | FLAG_PF | FLAG_CF },
+    /* SAR    */ { 0,                                       FLAG_STATUS                      },
+    /* SBB    */ { FLAG_CF,                                 FLAG_STATUS                      },
+    /* SCAS   */ { FLAG_DF,                                 FLAG_STATUS                      },
+    /* SHL    */ { 0,                                       FLAG_STATUS                      },
+    /* SHR    */ { 0,                                       FLAG_STATUS                      },
+    /* STC    */ { 0,                                       FLAG_CF                          },
+    /* STD    */ { 0,                                       FLAG_DF                          },
+    /* STI    */ { 0,                                       FLAG_IF                          },
+    /* STOS   */ { FLAG_DF,                                 0                                },
+    /* SUB    */ { 0,                                       FLAG_STATUS                      },
+    /* TEST   */ { 0,                                       FLAG_STATUS                      },
+    /* XCHG   */ { 0,                                       0                                },
+    /* XLAT   */ { 0,                                       0                                },
+    /* XOR    */ { 0,                                       FLAG_STATUS                      },
+}};
+
+// Operand slots for instr_regs
+#define S0 (1<<0)
+#define S1 (1<<1)
+#define S2 (1<<2)
+
+#define SP_   REG_BIT(REG_SP)
+#define SI_   REG_BIT(REG_SI)
+#define DI_   REG_BIT(REG_DI)
+#define SS_   REG_BIT(REG_SS)
+#define STACK (SP_ | SS_)
+
+const std::array<instr_regs_t, 93> instr_regs =
+{{
+    /* AAA    */ { S0 | S1,      S0 | S1,  0,                    0                                },
+    /* AAS    */ { S0 | S1,      S0 | S1,  0,                    0                                },
+    /* ADC    */ { S0 | S1,      S0,       0,                    0                                },
+    /* ADD    */ { S0 | S1,      S0,       0,                    0                                },
+    /* AND    */ { S0 | S1,      S0,       0,                    0                                },
+    /* CALL   */ { S0,           0,        REGS_ALL,             0                                },
+    /* CALLF  */ { S0,           0,        REGS_ALL,             0                                },
+    /* CBW    */ { S1,           S0,       0,                    0                                },
+    /* CLC    */ { 0,            0,        0,                    0                                },
+    /* CLD    */ { 0,            0,        0,                    0                                },
+    /* CLI    */ { 0,            0,        0,                    0                                },
+    /* CMC    */ { 0,            0,        0,                    0                                },
+    /* CMP    */ { S0 | S1,      0,        0,                    0                                },
+    /* CMPS   */ { S0 | S1,      0,        SI_ | DI_,            SI_ | DI_                        },
+    /* CWD    */ { S1,           S0,       0,                    0                                },
+    /* DAA    */ { S0,           S0,       0,                    0                                },
+    /* DAS    */ { S0,           S0,       0,                    0                                },
+    /* DEC    */ { S0,           S0,       0,                    0                                },
+    /* DIV    */ { S0 | S1 | S2, S0 | S1,  0,                    0                                },
+    /* ENTER  */ { S0,           S0,       STACK,                SP_                              },
+    /* HLT    */ { 0,            0,        0,                    0                                },
+    /* IMUL   */ { S1 | S2,      S0 | S1,  0,                    0                                }, /* S0 only with an immediate */
+    /* IN     */ { S1,           S0,       0,                    0                                },
+    /* INC    */ { S0,           S0,       0,                    0                                },
+    /* INS    */ { S0 | S1,      0,        DI_,                  DI_                              },
+    /* INT    */ { 0,            0,        REGS_ALL,             0                                },
+    /* INTO   */ { 0,            0,        REGS_ALL,             0                                },
+    /* INVAL  */ { 0,            0,        REGS_ALL,             0                                },
+    /* IRET   */ { 0,            0,        REGS_ALL,             0                                },
+    /* JA     */ { 0,            0,        0,                    0                                },
+    /* JAE    */ { 0,            0,        0,                    0                                },
+    /* JB     */ { 0,            0,        0,                    0                                },
+    /* JBE    */ { 0,            0,        0,                    0                                },
+    /* JCXZ   */ { S0,           0,        0,                    0                                },
+    /* JE     */ { 0,            0,        0,                    0                                },
+    /* JG     */ { 0,            0,        0,                    0                                },
+    /* JGE    */ { 0,            0,        0,                    0                                },
+    /* JL     */ { 0,            0,        0,                    0                                },
+    /* JLE    */ { 0,            0,        0,                    0                                },
+    /* JMP    */ { S0,           0,        0,                    0                                },
+    /* JMPF   */ { S0,           0,        0,                    0                                },
+    /* JNE    */ { 0,            0,        0,                    0                                },
+    /* JNO    */ { 0,            0,        0,                    0                                },
+    /* JNP    */ { 0,            0,        0,                    0                                },
+    /* JNS    */ { 0,            0,        0,                    0                                },
+    /* JO     */ { 0,            0,        0,                    0                                },
+    /* JP     */ { 0,            0,        0,                    0                                },
+    /* JS     */ { 0,            0,        0,                    0                                },
+    /* LAHF   */ { 0,            S0,       0,                    0                                },
+    /* LDS    */ { S2,           S0 | S1,  0,                    0                                },
+    /* LEA    */ { S1,           S0,       0,                    0                                },
+    /* LEAVE  */ { S0,           S0 | S1,  SS_,                  0                                },
+    /* LES    */ { S2,           S0 | S1,  0,                    0                                },
+    /* LODS   */ { S1,           S0,       SI_,                  SI_                              },
+    /* LOOP   */ { S0,           S0,       0,                    0                                },
+    /* LOOPE  */ { S0,           S0,       0,                    0                                },
+    /* LOOPNE */ { S0,           S0,       0,                    0                                },
+    /* MOV    */ { S1,           S0,       0,                    0                                },
+    /* MOVS   */ { S1,           S0,       SI_ | DI_,            SI_ | DI_                        },
+    /* MUL    */ { S1 | S2,      S0 | S1,  0,                    0                                },
+    /* NEG    */ { S0,           S0,       0,                    0                                },
+    /* NOP    */ { 0,            0,        0,                    0                                },
+    /* NOT    */ { S0,           S0,       0,                    0                                },
+    /* OR     */ { S0 | S1,      S0,       0,                    0                                },
+    /* OUT    */ { S0 | S1,      0,        0,                    0                                },
+    /* OUTS   */ { S0 | S1,      0,        SI_,                  SI_                              },
+    /* POP    */ { 0,            S0,       STACK,                SP_                              },
+    /* POPA   */ { 0,            0,        STACK,                REGS_GPR                         },
+    /* POPF   */ { 0,            0,        STACK,                SP_                              },
+    /* PUSH   */ { S0,           0,        STACK,                SP_                              },
+    /* PUSHA  */ { 0,            0,        STACK | REGS_GPR,     SP_                              },
+    /* PUSHF  */ { 0,            0,        STACK,                SP_                              },
+    /* RCL    */ { S0 | S1,      S0,       0,                    0                                },
+    /* RCR    */ { S0 | S1,      S0,       0,                    0                                },
+    /* RET    */ { 0,            0,        REGS_ALL,             0                                },
+    /* RETF   */ { 0,            0,        REGS_ALL,             0                                },
+    /* ROL    */ { S0 | S1,      S0,       0,                    0                                },
+    /* ROR    */ { S0 | S1,      S0,       0,                    0                                },
+    /* SAHF   */ { S0,           0,        0,                    0                                },
+    /* SAR    */ { S0 | S1,      S0,       0,                    0                                },
+    /* SBB    */ { S0 | S1,      S0,       0,                    0                                },
+    /* SCAS   */ { S0 | S1,      0,        DI_,                  DI_                              },
+    /* SHL    */ { S0 | S1,      S0,       0,                    0                                },
+    /* SHR    */ { S0 | S1,      S0,       0,                    0                                },
+    /* STC    */ { 0,            0,        0,                    0                                },
+    /* STD    */ { 0,            0,        0,                    0                                },
+    /* STI    */ { 0,            0,        0,                    0                                },
+    /* STOS   */ { S1,           0,        DI_,                  DI_                              },
+    /* SUB    */ { S0 | S1,      S0,       0,                    0                                },
+    /* TEST   */ { S0 | S1,      0,        0,                    0                                },
+    /* XCHG   */ { S0 | S1,      S0 | S1,  0,                    0                                },
+    /* XLAT   */ { S0 | S1 | S2, S0,       0,                    0                                },
+    /* XOR    */ { S0 | S1,      S0,       0,                    0                                },
+}};
+
+#undef S0
+#undef S1
+#undef S2
+#undef SP_
+#undef SI_
+#undef DI_
+#undef SS_
+#undef STACK
+
 void dis86_instr_copy(dis86_instr_t *dst, dis86_instr_t *src)
 {
   *dst = *src;
@@ -5,47 +5,79 @@
 
 #define OPERAND_MAX 3
 
+// id, width in bits, names, the 16-bit register it lives in and its byte
+// offset in the (symbolic) register file
 #define REGISTER_ARRAY(_)\
   /* Standard 16-bit registers */ \
-  _( REG_AX,    16, "ax",    "AX"    )\
-  _( REG_CX,    16, "cx",    "CX"    )\
-  _( REG_DX,    16, "dx",    "DX"    )\
-  _( REG_BX,    16, "bx",    "BX"    )\
-  _( REG_SP,    16, "sp",    "SP"    )\
-  _( REG_BP,    16, "bp",    "BP"    )\
-  _( REG_SI,    16, "si",    "SI"    )\
-  _( REG_DI,    16, "di",    "DI"    )\
+  _( REG_AX,    16, "ax",    "AX",    REG_AX,     0 )\
+  _( REG_CX,    16, "cx",    "CX",    REG_CX,     2 )\
+  _( REG_DX,    16, "dx",    "DX",    REG_DX,     4 )\
+  _( REG_BX,    16, "bx",    "BX",    REG_BX,     6 )\
+  _( REG_SP,    16, "sp",    "SP",    REG_SP,     8 )\
+  _( REG_BP,    16, "bp",    "BP",    REG_BP,    10 )\
+  _( REG_SI,    16, "si",    "SI",    REG_SI,    12 )\
+  _( REG_DI,    16, "di",    "DI",    REG_DI,    14 )\
   /* Standard 8-bit registers (may overlap with above) */\
-  _( REG_AL,     8, "al",    "AL"    )\
-  _( REG_CL,     8, "cl",    "CL"    )\
-  _( REG_DL,     8, "dl",    "DL"    )\
-  _( REG_BL,     8, "bl",    "BL"    )\
-  _( REG_AH,     8, "ah",    "AH"    )\
-  _( REG_CH,     8, "ch",    "CH"    )\
-  _( REG_DH,     8, "dh",    "DH"    )\
-  _( REG_BH,     8, "bh",    "BH"    )\
+  _( REG_AL,     8, "al",    "AL",    REG_AX,     0 )\
+  _( REG_CL,     8, "cl",    "CL",    REG_CX,     2 )\
+  _( REG_DL,     8, "dl",    "DL",    REG_DX,     4 )\
+  _( REG_BL,     8, "bl",    "BL",    REG_BX,     6 )\
+  _( REG_AH,     8, "ah",    "AH",    REG_AX,     1 )\
+  _( REG_CH,     8, "ch",    "CH",    REG_CX,     3 )\
+  _( REG_DH,     8, "dh",    "DH",    REG_DX,     5 )\
+  _( REG_BH,     8, "bh",    "BH",    REG_BX,     7 )\
   /* Segment registers */\
-  _( REG_ES,    16, "es",    "ES"    )\
-  _( REG_CS,    16, "cs",    "CS"    )\
-  _( REG_SS,    16, "ss",    "SS"    )\
-  _( REG_DS,    16, "ds",    "DS"    )\
+  _( REG_ES,    16, "es",    "ES",    REG_ES,    16 )\
+  _( REG_CS,    16, "cs",    "CS",    REG_CS,    18 )\
+  _( REG_SS,    16, "ss",    "SS",    REG_SS,    20 )\
+  _( REG_DS,    16, "ds",    "DS",    REG_DS,    22 )\
   /* Other registers */\
-  _( REG_IP,    16, "ip",    "IP"    )\
-  _( REG_FLAGS, 16, "flags", "FLAGS" )\
+  _( REG_IP,    16, "ip",    "IP",    REG_IP,    24 )\
+  _( REG_FLAGS, 16, "flags", "FLAGS", REG_FLAGS, 26 )\
 
 enum {
   REG_INVAL = 0,
-#define ELT(r, _1, _2, _3) r,
+#define ELT(r, _1, _2, _3, _4, _5) r,
   REGISTER_ARRAY(ELT)
 #undef ELT
   _REG_LAST,
 };
 
+struct reg_info_t
+{
+  uint8_t  bits;
+  uint8_t  off;     // byte offset in the register file
+  uint8_t  parent;  // the 16-bit register holding this one (itself if 16-bit)
+  uint32_t alias;   // bit per register id sharing any byte with this one
+};
+
+// Indexed by register id; REG_INVAL is all zero
+static constexpr std::array<reg_info_t, _REG_LAST> reg_info = [] {
+  std::array<reg_info_t, _REG_LAST> arr {};
+#define ELT(r, bits, _2, _3, parent, off) arr[r] = reg_info_t{bits, off, parent, 0};
+  REGISTER_ARRAY(ELT)
+#undef ELT
+  for (int a = 1; a < _REG_LAST; a++) {
+    for (int b = 1; b < _REG_LAST; b++) {
+      int a_end = arr[a].off + arr[a].bits/8;
+      int b_end = arr[b].off + arr[b].bits/8;
+      if (arr[a].off < b_end && arr[b].off < a_end) arr[a].alias |= (uint32_t)1 << b;
+    }
+  }
+  return arr;
+}();
+static_assert(_REG_LAST <= 32, "reg_info_t::alias holds one bit per register");
+
+#define REG_BIT(r)  ((uint32_t)1 << (r))
+#define REGS_GPR    (REG_BIT(REG_AX) | REG_BIT(REG_CX) | REG_BIT(REG_DX) | REG_BIT(REG_BX) | \
+                     REG_BIT(REG_SP) | REG_BIT(REG_BP) | REG_BIT(REG_SI) | REG_BIT(REG_DI))
+#define REGS_ALL    (((REG_BIT(_REG_LAST) - 1) & ~REG_BIT(REG_INVAL)) & ~(REG_BIT(REG_IP) | REG_BIT(REG_FLAGS)))
+
 static inline const char *reg_name(int reg)
 {
   static const char *arr[] = {
     nullptr,
-#define ELT(_1, _2, s, _3) s,
+#define ELT(_1, _2, s, _3, _4, _5) s,
   REGISTER_ARRAY(ELT)
 #undef ELT
   };
@@ -57,7 +89,7 @@ static inline const char *reg_name_upper(int reg)
 {
   static const char *arr[] = {
     nullptr,
-#define ELT(_1, _2, _3, s) s,
+#define ELT(_1, _2, _3, s, _4, _5) s,
   REGISTER_ARRAY(ELT)
 #undef ELT
   };
@@ -172,6 +204,7 @@ struct operand_imm_t
 {
   int sz;
   uint16_t val;
+  bool reloc;  // val is a segment constant patched by the loader
 };
 
 struct operand_rel_t
@@ -183,6 +216,7 @@ struct operand_far_t
 {
   uint16_t seg;
   uint16_t off;
+  bool reloc;  // seg is patched by the loader
 };
 
 struct operand_t
@@ -226,4 +260,43 @@ struct instr_fmt_t
 extern std::array<instr_fmt_t, 367> instr_tbl;
 
 extern const std::array<const char* const, 93> instr_op_mneumonic;
+
+// FLAGS register bits
+enum {
+  FLAG_CF = 1<<0,
+  FLAG_PF = 1<<2,
+  FLAG_AF = 1<<4,
+  FLAG_ZF = 1<<6,
+  FLAG_SF = 1<<7,
+  FLAG_TF = 1<<8,
+  FLAG_IF = 1<<9,
+  FLAG_DF = 1<<10,
+  FLAG_OF = 1<<11,
+};
+#define FLAG_STATUS (FLAG_CF | FLAG_PF | FLAG_AF | FLAG_ZF | FLAG_SF | FLAG_OF)
+#define FLAG_ALL    (FLAG_STATUS | FLAG_TF | FLAG_IF | FLAG_DF)
+
+// Flag bits each operation reads and (possibly) writes, indexed by operation_e.
+// Bits left undefined by an operation count as written.
+struct instr_flags_t
+{
+  uint16_t read;
+  uint16_t written;
+};
+extern const std::array<instr_flags_t, 93> instr_flags;
+
+// Registers each operation reads and writes, indexed by operation_e. The
+// operand slots refer to the decoded operands (bit i is operand[i]), which
+// spell out the implied registers of instr_tbl as well. The masks (REG_BIT)
+// cover what no operand lists: the stack pointer, string indexes and, for
+// control leaving the function, everything. 'def' only holds registers
+// written on every execution; FLAGS and IP are never included.
+struct instr_regs_t
+{
+  uint8_t  read;      /* operand slots read */
+  uint8_t  written;   /* operand slots written */
+  uint32_t use;       /* registers read without an operand */
+  uint32_t def;       /* registers written without an operand */
+};
+extern const std::array<instr_regs_t, 93> instr_regs;
 int instr_fmt_lookup(uint8_t opcode1, uint8_t opcode2, instr_fmt_t **fmt);
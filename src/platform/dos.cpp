@@ -1,6 +1,71 @@
 #include "dos.h"
 
+#include <algorithm>
+
 namespace dos
 {
+  bool relocation_index_t::contains(uint32_t addr) const
+  {
+    return std::binary_search(addrs.begin(), addrs.end(), addr);
+  }
+
+  bool relocation_index_t::overlaps(uint32_t addr, size_t len) const
+  {
+    if (len == 0) return false;
+    // A patched word starting at addr-1 still covers addr
+    uint32_t first = addr ? addr - 1 : 0;
+    auto it = std::lower_bound(addrs.begin(), addrs.end(), first);
+    return it != addrs.end() && *it < addr + len;
+  }
+
+  bool executable_t::open(const std::string& filename)
+  {
+    if (!file.open(filename))
+      return false;
+
+    if (file.size() < sizeof(executable_header_t)) {
+      close();
+      return false;
+    }
+
+    header = file.data<const executable_header_t>();
+    if (header->signature != executable_signature) {
+      close();
+      return false;
+    }
+
+    executable_layout_t layout = { *header };
+    size_t image_start = layout.exe_offset();
+    size_t image_end   = layout.extra_offset();
+    size_t reloc_start = header->reloc_table_offset;
+    size_t reloc_end   = reloc_start + header->num_relocs * sizeof(relocation_t);
+    if (image_start > image_end || image_end > file.size() || reloc_end > file.size()) {
+      close();
+      return false;
+    }
+
+    image       = file.segment<uint8_t>(image_start, image_end - image_start);
+    relocations = file.segment<relocation_t>(reloc_start, header->num_relocs);
+
+    // Single pass over the table: linkers almost always emit it in order, so
+    // only sort when we have to.
+    relocs.addrs.resize(relocations.size());
+    for (size_t i = 0; i < relocations.size(); i++) {
+      relocs.addrs[i] = relocations[i].linear();
+    }
+    if (!std::is_sorted(relocs.addrs.begin(), relocs.addrs.end())) {
+      std::sort(relocs.addrs.begin(), relocs.addrs.end());
+    }
+
+    return true;
+  }
 
+  void executable_t::close(void)
+  {
+    relocs.addrs.clear();
+    relocations = {};
+    image = {};
+    header = nullptr;
+    file.close();
+  }
 }
@@ -1,12 +1,19 @@
 #pragma once
 #include <cstdint>
 #include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "common/segment.h"
+#include "common/mapped_file.h"
 
 namespace dos
 {
   using paragraph_t = uint8_t[16];
   using block_t = uint8_t[512];
 
+  constexpr uint16_t executable_signature = 0x5a4D; // "MZ"
+
   struct [[gnu::packed]] executable_header_t
   {
     uint16_t signature; // 0x5a4D
@@ -30,7 +37,10 @@ namespace dos
   {
     uint16_t offset; // Offset of the relocation within provided segment.
     uint16_t segment; // Segment of the relocation, relative to the load segment address.
+
+    constexpr uint32_t linear(void) const { return uint32_t(segment) * sizeof(paragraph_t) + offset; }
   };
+  static_assert(sizeof(relocation_t) == 4);
 
 
   struct executable_layout_t
@@ -45,5 +55,29 @@ namespace dos
 
     executable_header_t header;
   };
-}
 
+  // Sorted linear addresses (relative to the start of the load image) of every
+  // 16-bit word the loader patches with the load segment. A hit means the word
+  // is a segment constant rather than a plain immediate.
+  struct relocation_index_t
+  {
+    bool contains(uint32_t addr) const;
+    bool overlaps(uint32_t addr, size_t len) const; // any patched word intersecting [addr, addr+len)
+
+    std::vector<uint32_t> addrs;
+  };
+
+  // An MZ executable mapped straight from disk. The header, relocation table
+  // and load image are all views into the mapping: nothing is copied.
+  struct executable_t
+  {
+    bool open(const std::string& filename);
+    void close(void);
+
+    mapped_file                 file;
+    const executable_header_t * header = nullptr;
+    segment<relocation_t>       relocations;
+    segment<uint8_t>            image;       // the load image, linear address 0 == load segment:0000
+    relocation_index_t          relocs;
+  };
+}
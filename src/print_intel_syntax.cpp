@@ -17,7 +17,7 @@ static void print_operand_intel_syntax(std::string& s, dis86_instr_t *ins, const
       s += ":";
       if (!m.reg1 && !m.reg2) {
         if (m.off)
-          s += m.off;
+          std::format_to<"0x%x">(std::back_inserter(s), m.off);
       } else {
         s += "[";
         if (m.reg1)
@@ -31,24 +31,24 @@ static void print_operand_intel_syntax(std::string& s, dis86_instr_t *ins, const
         if (m.off) {
           int16_t disp = (int16_t)m.off;
           if (disp >= 0)
-            s += std::format<"+0x%x">((uint16_t)disp);
+            std::format_to<"+0x%x">(std::back_inserter(s), (uint16_t)disp);
           else
-            s += std::format<"-0x%x">((uint16_t)-disp);
+            std::format_to<"-0x%x">(std::back_inserter(s), (uint16_t)-disp);
         }
         s += "]";
       }
     } break;
     case OPERAND_TYPE_IMM:
-      s += std::format<"0x%x">(o.u.imm.val);
+      std::format_to<"0x%x">(std::back_inserter(s), o.u.imm.val);
       break;
 
     case OPERAND_TYPE_REL:
     {
       uint16_t effective = ins->addr + ins->n_bytes + o.u.rel.val;
-      s += std::format<"0x%x">(effective);
+      std::format_to<"0x%x">(std::back_inserter(s), effective);
     } break;
     case OPERAND_TYPE_FAR:
-      s += std::format<"0x%x:0x%x">(o.u.far.seg, o.u.far.off);
+      std::format_to<"0x%x:0x%x">(std::back_inserter(s), o.u.far.seg, o.u.far.off);
       break;
     default:
       FAIL("INVALID OPERAND TYPE: %d", o.type);
@@ -59,15 +59,15 @@ std::string dis86_print_intel_syntax(dis86_t *d, dis86_instr_t *ins, bool with_d
 {
   std::string s;
   if (with_detail) {
-    s += std::format<"%8zx:\t">(ins->addr);
+    std::format_to<"%8zx:\t">(std::back_inserter(s), ins->addr);
     for (size_t i = 0; i < ins->n_bytes; i++)
     {
-      s += std::format<"%02x ">(binary_byte_at(d->b, ins->addr + i));
+      std::format_to<"%02x ">(std::back_inserter(s), binary_byte_at(d->b, ins->addr + i));
     }
     size_t used = ins->n_bytes * 3;
     size_t remain = (used <= 21) ? 21 - used : 0;
 
-    s += std::format<"%*s\t">((int)remain, " ");
+    std::format_to<"%*s\t">(std::back_inserter(s), (int)remain, " ");
   }
 
   if (ins->rep == REP_NE)
@@ -75,7 +75,7 @@ std::string dis86_print_intel_syntax(dis86_t *d, dis86_instr_t *ins, bool with_d
   else if (ins->rep == REP_E)
     s += "rep ";
 
-  s += std::format<"%-5s">(instr_op_mneumonic[int(ins->opcode)]);
+  std::format_to<"%-5s">(std::back_inserter(s), instr_op_mneumonic[int(ins->opcode)]);
 
   int n_operands = 0;
   for (size_t i = 0; i < ins->operand.size(); i++)
@@ -94,10 +94,8 @@ std::string dis86_print_intel_syntax(dis86_t *d, dis86_instr_t *ins, bool with_d
     n_operands++;
   }
 
-  /* remove any trailing space */  
-  if(size_t pos = s.rfind(' ');
-      pos != std::string::npos)
-    s.erase(pos);
+  /* remove any trailing space (from padding the mnemonic) */
+  s.erase(s.find_last_not_of(' ') + 1);
   return s;
 }
 
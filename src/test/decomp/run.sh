@@ -0,0 +1,27 @@
+#!/bin/sh
+# Decompiles each fixture binary in this directory from start to end and
+# compares the result against <name>.expected next to it.
+#
+#   run.sh path/to/dis86            check every fixture
+#   run.sh path/to/dis86 --update   rewrite the .expected files
+DIS86=$1
+DIR=$(dirname "$0")
+fail=0
+
+for bin in "$DIR"/*.bin; do
+  name=${bin%.bin}
+  end=$(printf "0000:%04x" "$(wc -c < "$bin")")
+  out=$("$DIS86" decomp --binary "$bin" --start-addr 0000:0000 --end-addr "$end" 2>&1)
+
+  if [ "$2" = "--update" ]; then
+    printf '%s\n' "$out" > "$name.expected"
+  elif printf '%s\n' "$out" | diff -u "$name.expected" - > /dev/null; then
+    echo "PASS $(basename "$name")"
+  else
+    echo "FAIL $(basename "$name")"
+    printf '%s\n' "$out" | diff -u "$name.expected" -
+    fail=1
+  fi
+done
+
+exit $fail